@@ -7,21 +7,84 @@ CC="${HOME}/Code/sdcc-4.1.0/bin/sdcc"
 devkitSMS="${HOME}/Code/devkitSMS"
 SMSlib="${devkitSMS}/SMSlib"
 ihx2sms="${devkitSMS}/ihx2sms/Linux/ihx2sms"
+HOSTCC="${HOSTCC:-cc}"
 
-CFLAGS="--std-c11 -mz80 --peep-file ${devkitSMS}/SMSlib/src/peep-rules.txt -I ${SMSlib}/src"
+CFLAGS="--std-c11 -mz80 --peep-file ${devkitSMS}/SMSlib/src/peep-rules.txt -I ${SMSlib}/src -I work"
+LDFLAGS=""
 
 rm -r work
 mkdir -p work
 
+# Compile a source file into the fixed slots
+compile_fixed ()
+{
+    eval $CC $CFLAGS -c ${1}.c -o work/$(basename ${1}).rel || exit 1
+}
+
+# Compile a source file into a ROM bank, to be paged into slot 2.
+# Bank numbers must match those in sneptest.h
+compile_banked ()
+{
+    eval $CC $CFLAGS --codeseg BANK${2} --constseg BANK${2} -c ${1}.c -o work/$(basename ${1}).rel || exit 1
+    case "${LDFLAGS}" in
+        *"_BANK${2}="*) ;;
+        *) LDFLAGS="${LDFLAGS} -Wl-b_BANK${2}=$(printf "0x%X8000" ${2})" ;;
+    esac
+}
+
+# Host tools used to generate assets
+build_tools ()
+{
+    echo "Building tools..."
+    eval $HOSTCC -std=c11 -O2 tools/tilepack.c -o work/tilepack || exit 1
+    eval $HOSTCC -std=c11 -O2 tools/mapgen.c -o work/mapgen || exit 1
+    eval $HOSTCC -std=c11 -O2 tools/screengen.c -o work/screengen || exit 1
+}
+
+# Full-screen test patterns, loaded after the 63 font tiles
+build_assets ()
+{
+    echo "Converting assets..."
+    for asset in gradient checkerboard alignment_grid
+    do
+        work/tilepack assets/${asset}.txt ${asset} 64 work/${asset} || exit 1
+        compile_banked work/${asset} 5
+    done
+
+    # Map for the streaming test, one bank per 64 rows
+    work/mapgen work/map || exit 1
+    for bank in 0 1 2 3
+    do
+        compile_banked work/map_${bank} $((6 + bank))
+    done
+
+    # Static layouts of the test screens
+    work/screengen work/screens assets/screens/*.txt || exit 1
+    compile_banked work/screens 11
+}
+
 build_sneptest ()
 {
+    build_tools
+    build_assets
+
     echo "Compiling..."
-    eval $CC $CFLAGS -c source/main.c -o work/main.rel || exit 1
-    eval $CC $CFLAGS -c source/input_tests.c -o work/input_tests.rel || exit 1
-    eval $CC $CFLAGS -c source/vdp_tests.c -o work/vdp_tests.rel || exit 1
+    compile_fixed source/main
+    compile_fixed source/scheduler
+    compile_fixed source/system_tests
+    compile_fixed source/vram_stream
+    compile_fixed source/map_stream
+    compile_fixed source/psg_player
+    compile_fixed source/hud
+    compile_fixed source/palette_band
+    compile_banked source/font 2
+    compile_banked source/input_tests 3
+    compile_banked source/vdp_tests 4
+    compile_banked source/vdp_timing_tests 4
+    compile_banked source/sound_tests 10
 
     echo "Linking..."
-    eval $CC -o work/sneptest.ihx -mz80 --no-std-crt0 --data-loc 0xC000 ${devkitSMS}/crt0/crt0_sms.rel work/*.rel ${SMSlib}/SMSlib.lib || exit 1
+    eval $CC -o work/sneptest.ihx -mz80 --no-std-crt0 --data-loc 0xC000 ${LDFLAGS} ${devkitSMS}/crt0/crt0_sms.rel work/*.rel ${SMSlib}/SMSlib.lib || exit 1
 
     echo "Generating ROM..."
     eval $ihx2sms work/sneptest.ihx sneptest.sms || exit 1
@@ -30,5 +93,3 @@ build_sneptest ()
 }
 
 build_sneptest
-
-
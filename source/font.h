@@ -0,0 +1,2 @@
+extern const uint8_t font_patterns[];
+#define FONT_PATTERNS_SIZE (63 * 8)
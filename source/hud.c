@@ -0,0 +1,212 @@
+/*
+ * Sneptest SMS - Sprite HUD
+ *
+ * Shows text and numbers using sprites, with the font tiles from the
+ * first half of VRAM. Unlike draw_string, this does not touch the
+ * name table, so readouts stay in place during scrolling tests, and
+ * changing a value costs only a few SAT bytes.
+ *
+ * The HUD owns the SAT while in use. A copy of each sprite is kept
+ * in RAM alongside what was last written to the SAT, so that
+ * hud_update only writes the bytes that have changed.
+ *
+ * Sprites are added once when a screen is set up. A sprite at
+ * Y = 209 is shown a line lower, as the SAT holds Y - 1, and 208
+ * would end the sprite list.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "SMSlib.h"
+#include "hud.h"
+
+/* VDP write addresses for the SAT's Y table, and X / tile table */
+#define HUD_SAT_Y       0x7f00
+#define HUD_SAT_XN      0x7f80
+#define HUD_SAT_END     0xd0
+
+#define HUD_VALUES_MAX  8
+
+__sfr __at (0xbe) VDPDataPort;
+
+/* Sprites wanted */
+static uint8_t hud_y [HUD_SPRITES_MAX];
+static uint8_t hud_x [HUD_SPRITES_MAX];
+static uint8_t hud_tile [HUD_SPRITES_MAX];
+static uint8_t hud_count = 0;
+
+/* Sprites in the SAT */
+static uint8_t hud_sat_y [HUD_SPRITES_MAX];
+static uint8_t hud_sat_x [HUD_SPRITES_MAX];
+static uint8_t hud_sat_tile [HUD_SPRITES_MAX];
+static uint8_t hud_sat_count = 0;
+
+/* Numeric values, each a run of digit sprites */
+static uint8_t hud_value_sprite [HUD_VALUES_MAX];
+static uint8_t hud_value_digits [HUD_VALUES_MAX];
+static bool hud_value_decimal [HUD_VALUES_MAX];
+static uint8_t hud_value_count = 0;
+
+
+/*
+ * Remove all sprites, both from the HUD and from the SAT.
+ * Also selects the font tiles for sprites.
+ */
+void hud_reset (void)
+{
+    hud_count = 0;
+    hud_sat_count = 0;
+    hud_value_count = 0;
+
+    SMS_useFirstHalfTilesforSprites (true);
+
+    SMS_setAddr (HUD_SAT_Y);
+    VDPDataPort = HUD_SAT_END;
+}
+
+
+void hud_sprite_move (uint8_t sprite, uint8_t x, uint8_t y)
+{
+    if (sprite >= hud_count)
+    {
+        return;
+    }
+
+    hud_x [sprite] = x;
+    hud_y [sprite] = (y == HUD_SAT_END + 1) ? y : y - 1;
+}
+
+
+/*
+ * Add a sprite, returning its index for hud_sprite_move,
+ * or HUD_NONE if there are already HUD_SPRITES_MAX sprites.
+ */
+uint8_t hud_sprite_add (uint8_t x, uint8_t y, uint8_t tile)
+{
+    uint8_t sprite;
+
+    if (hud_count >= HUD_SPRITES_MAX)
+    {
+        return HUD_NONE;
+    }
+
+    sprite = hud_count++;
+    hud_tile [sprite] = tile;
+    hud_sprite_move (sprite, x, y);
+
+    return sprite;
+}
+
+
+/*
+ * Add a string that will not change. Spaces do not use a sprite.
+ */
+void hud_label_add (uint8_t x, uint8_t y, const char *string)
+{
+    for (; *string != '\0'; string++, x += 8)
+    {
+        if (*string != ' ')
+        {
+            hud_sprite_add (x, y, *string - ' ');
+        }
+    }
+}
+
+
+/*
+ * Add a number, shown as hex with leading zeros, or decimal with
+ * leading spaces. Returns its index for hud_value_set, or HUD_NONE
+ * if there is no room for another value or for its digits.
+ */
+uint8_t hud_value_add (uint8_t x, uint8_t y, uint8_t digits, bool decimal)
+{
+    if (hud_value_count >= HUD_VALUES_MAX || hud_count + digits > HUD_SPRITES_MAX)
+    {
+        return HUD_NONE;
+    }
+
+    hud_value_sprite [hud_value_count] = hud_count;
+    hud_value_digits [hud_value_count] = digits;
+    hud_value_decimal [hud_value_count] = decimal;
+
+    for (uint8_t i = 0; i < digits; i++, x += 8)
+    {
+        hud_sprite_add (x, y, decimal ? 0 : '0' - ' ');
+    }
+
+    return hud_value_count++;
+}
+
+
+/*
+ * Change the number shown. Only the sprite tiles are changed.
+ */
+void hud_value_set (uint8_t value, uint16_t number)
+{
+    uint8_t sprite;
+    uint8_t digit;
+
+    if (value >= hud_value_count)
+    {
+        return;
+    }
+
+    sprite = hud_value_sprite [value] + hud_value_digits [value] - 1;
+
+    for (uint8_t i = 0; i < hud_value_digits [value]; i++, sprite--)
+    {
+        if (hud_value_decimal [value])
+        {
+            digit = number % 10;
+            number /= 10;
+        }
+        else
+        {
+            digit = number & 0x0f;
+            number >>= 4;
+        }
+
+        if (hud_value_decimal [value] && digit == 0 && number == 0 && i != 0)
+        {
+            hud_tile [sprite] = 0;
+        }
+        else
+        {
+            hud_tile [sprite] = (digit < 10) ? ('0' - ' ' + digit) : ('A' - ' ' + digit - 10);
+        }
+    }
+}
+
+
+/*
+ * VRAM job to write any changes to the SAT.
+ */
+void hud_update (void)
+{
+    for (uint8_t i = 0; i < hud_count; i++)
+    {
+        if (i >= hud_sat_count || hud_y [i] != hud_sat_y [i])
+        {
+            SMS_setAddr (HUD_SAT_Y + i);
+            VDPDataPort = hud_y [i];
+            hud_sat_y [i] = hud_y [i];
+        }
+
+        if (i >= hud_sat_count || hud_x [i] != hud_sat_x [i] || hud_tile [i] != hud_sat_tile [i])
+        {
+            SMS_setAddr (HUD_SAT_XN + 2 * i);
+            VDPDataPort = hud_x [i];
+            VDPDataPort = hud_tile [i];
+            hud_sat_x [i] = hud_x [i];
+            hud_sat_tile [i] = hud_tile [i];
+        }
+    }
+
+    /* Terminate the sprite list after the new sprites */
+    if (hud_count != hud_sat_count)
+    {
+        SMS_setAddr (HUD_SAT_Y + hud_count);
+        VDPDataPort = HUD_SAT_END;
+        hud_sat_count = hud_count;
+    }
+}
@@ -0,0 +1,13 @@
+
+#define HUD_SPRITES_MAX 32
+
+/* Returned when the HUD is full. Ignored by hud_sprite_move and hud_value_set */
+#define HUD_NONE        0xff
+
+void hud_reset (void);
+uint8_t hud_sprite_add (uint8_t x, uint8_t y, uint8_t tile);
+void hud_sprite_move (uint8_t sprite, uint8_t x, uint8_t y);
+void hud_label_add (uint8_t x, uint8_t y, const char *string);
+uint8_t hud_value_add (uint8_t x, uint8_t y, uint8_t digits, bool decimal);
+void hud_value_set (uint8_t value, uint16_t number);
+void hud_update (void);
@@ -4,98 +4,132 @@
 
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdio.h>
 #include "SMSlib.h"
 #include "sneptest.h"
+#include "scheduler.h"
+#include "hud.h"
+
+#include "screens.h"
+
+/* Input test state */
+static uint16_t input_pressed = 0;
+static uint8_t input_pause_counter = 0;
+static uint8_t input_pause_counter_value = 0;
+
 
 /*
- * Test for 2-button SMS gamepad behaviour.
+ * VRAM job to show the state of each gamepad button.
  */
-static void input_test_2_button (void)
+static void input_test_2_button_render (void)
+{
+    uint16_t pressed = input_pressed;
+
+    if (pressed & PORT_A_KEY_UP)    draw_string (1,   7,  "->"); else draw_string (1,   7,  "  ");
+    if (pressed & PORT_A_KEY_DOWN)  draw_string (1,   9,  "->"); else draw_string (1,   9,  "  ");
+    if (pressed & PORT_A_KEY_LEFT)  draw_string (1,  11,  "->"); else draw_string (1,  11,  "  ");
+    if (pressed & PORT_A_KEY_RIGHT) draw_string (1,  13,  "->"); else draw_string (1,  13,  "  ");
+    if (pressed & PORT_A_KEY_1)     draw_string (1,  15,  "->"); else draw_string (1,  15,  "  ");
+    if (pressed & PORT_A_KEY_2)     draw_string (1,  17,  "->"); else draw_string (1,  17,  "  ");
+
+    if (pressed & PORT_B_KEY_UP)    draw_string (17,  7,  "->"); else draw_string (17,  7,  "  ");
+    if (pressed & PORT_B_KEY_DOWN)  draw_string (17,  9,  "->"); else draw_string (17,  9,  "  ");
+    if (pressed & PORT_B_KEY_LEFT)  draw_string (17, 11,  "->"); else draw_string (17, 11,  "  ");
+    if (pressed & PORT_B_KEY_RIGHT) draw_string (17, 13,  "->"); else draw_string (17, 13,  "  ");
+    if (pressed & PORT_B_KEY_1)     draw_string (17, 15,  "->"); else draw_string (17, 15,  "  ");
+    if (pressed & PORT_B_KEY_2)     draw_string (17, 17,  "->"); else draw_string (17, 17,  "  ");
+}
+
+
+/*
+ * CPU job for the 2-button gamepad test. Only
+ * redraws when the state of the buttons changes.
+ */
+static bool input_test_2_button_input (void)
 {
-    char string_buf[3] = { '\0' };
-    unsigned int scroll_x = 0;
-    unsigned int scroll_y = 0;
-    uint8_t line;
-
-    clear_screen ();
-    title_draw ("2 BUTTON GAMEPAD");
-    reference_draw ("          1 + 2: BACK           ");
-
-    draw_string (4, line  = 4,  "PLAYER 1");
-    draw_string (4, line += 3,  "UP");
-    draw_string (4, line += 2,  "DOWN");
-    draw_string (4, line += 2,  "LEFT");
-    draw_string (4, line += 2,  "RIGHT");
-    draw_string (4, line += 2,  "BUTTON 1");
-    draw_string (4, line += 2,  "BUTTON 2");
-
-    draw_string (20, line  = 4,  "PLAYER 2");
-    draw_string (20, line += 3,  "UP");
-    draw_string (20, line += 2,  "DOWN");
-    draw_string (20, line += 2,  "LEFT");
-    draw_string (20, line += 2,  "RIGHT");
-    draw_string (20, line += 2,  "BUTTON 1");
-    draw_string (20, line += 2,  "BUTTON 2");
-
-    while (true)
+    uint16_t pressed = SMS_getKeysStatus ();
+
+    if ((pressed & PORT_A_KEY_1) && (pressed & PORT_A_KEY_2)) return false;
+
+    if (pressed != input_pressed)
     {
-        unsigned int pressed;
-
-        SMS_waitForVBlank ();
-        pressed = SMS_getKeysStatus ();
-
-        if (pressed & PORT_A_KEY_UP)    draw_string (1,   7,  "->"); else draw_string (1,   7,  "  ");
-        if (pressed & PORT_A_KEY_DOWN)  draw_string (1,   9,  "->"); else draw_string (1,   9,  "  ");
-        if (pressed & PORT_A_KEY_LEFT)  draw_string (1,  11,  "->"); else draw_string (1,  11,  "  ");
-        if (pressed & PORT_A_KEY_RIGHT) draw_string (1,  13,  "->"); else draw_string (1,  13,  "  ");
-        if (pressed & PORT_A_KEY_1)     draw_string (1,  15,  "->"); else draw_string (1,  15,  "  ");
-        if (pressed & PORT_A_KEY_2)     draw_string (1,  17,  "->"); else draw_string (1,  17,  "  ");
-
-        if (pressed & PORT_B_KEY_UP)    draw_string (17,  7,  "->"); else draw_string (17,  7,  "  ");
-        if (pressed & PORT_B_KEY_DOWN)  draw_string (17,  9,  "->"); else draw_string (17,  9,  "  ");
-        if (pressed & PORT_B_KEY_LEFT)  draw_string (17, 11,  "->"); else draw_string (17, 11,  "  ");
-        if (pressed & PORT_B_KEY_RIGHT) draw_string (17, 13,  "->"); else draw_string (17, 13,  "  ");
-        if (pressed & PORT_B_KEY_1)     draw_string (17, 15,  "->"); else draw_string (17, 15,  "  ");
-        if (pressed & PORT_B_KEY_2)     draw_string (17, 17,  "->"); else draw_string (17, 17,  "  ");
-
-        if ((pressed & PORT_A_KEY_1) && (pressed & PORT_A_KEY_2)) break;
+        input_pressed = pressed;
+        sched_vram_queue (input_test_2_button_render);
     }
+
+    return true;
 }
 
 
 /*
- * Test the pause and reset buttons.
+ * Test for 2-button SMS gamepad behaviour.
  */
-static void input_test_pause_reset (void)
+static void input_test_2_button (void)
 {
-    uint16_t pressed = 0;
-    uint8_t pause_counter = 0;
-    char string_buf[20] = { '\0' };
+    screen_load (screen_input_2_button);
 
-    clear_screen ();
-    title_draw ("PAUSE & RESET");
-    reference_draw ("             2: BACK            ");
+    input_pressed = SMS_getKeysStatus ();
+    sched_vram_queue (input_test_2_button_render);
+    sched_run (input_test_2_button_input);
+}
 
-    draw_string (4, 9,  "PAUSE COUNTER:");
-    draw_string (4, 13, "RESET:");
 
-    while (!(pressed & PORT_A_KEY_2))
-    {
-        SMS_waitForVBlank ();
+/*
+ * VRAM job to show the pause counter and reset button state.
+ */
+static void input_test_pause_reset_render (void)
+{
+    hud_update ();
+    draw_string (11, 13, input_pressed & RESET_KEY ? "PRESSED    " : "NOT PRESSED");
+}
+
+
+/*
+ * CPU job for the pause and reset test.
+ */
+static bool input_test_pause_reset_input (void)
+{
+    uint16_t pressed = SMS_getKeysStatus ();
 
-        pressed = SMS_getKeysStatus ();
-        if (SMS_queryPauseRequested ())
-        {
-            SMS_resetPauseRequest ();
-            pause_counter++;
-        }
+    if (pressed & PORT_A_KEY_2)
+    {
+        return false;
+    }
 
-        sprintf (string_buf, "%d", pause_counter);
-        draw_string (19, 9, string_buf);
+    if (SMS_queryPauseRequested ())
+    {
+        SMS_resetPauseRequest ();
+        input_pause_counter++;
+        hud_value_set (input_pause_counter_value, input_pause_counter);
+        sched_vram_queue (input_test_pause_reset_render);
+    }
 
-        draw_string (11, 13, pressed & RESET_KEY ? "PRESSED    " : "NOT PRESSED");
+    if ((pressed ^ input_pressed) & RESET_KEY)
+    {
+        sched_vram_queue (input_test_pause_reset_render);
     }
+    input_pressed = pressed;
+
+    return true;
+}
+
+
+/*
+ * Test the pause and reset buttons.
+ */
+static void input_test_pause_reset (void)
+{
+    screen_load (screen_input_pause_reset);
+
+    input_pause_counter = 0;
+    hud_reset ();
+    input_pause_counter_value = hud_value_add (152, 72, 3, true);
+    hud_value_set (input_pause_counter_value, input_pause_counter);
+
+    input_pressed = SMS_getKeysStatus ();
+    sched_vram_queue (input_test_pause_reset_render);
+    sched_run (input_test_pause_reset_input);
+
+    hud_reset ();
 }
 
 
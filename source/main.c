@@ -14,87 +14,49 @@
 #include "SMSlib.h"
 
 #include "sneptest.h"
+#include "scheduler.h"
+#include "font.h"
+#include "screens.h"
 #include "input_tests.h"
 #include "vdp_tests.h"
+#include "system_tests.h"
+#include "sound_tests.h"
 
-SMS_EMBED_SEGA_ROM_HEADER (9999, 0);
+__sfr __at (0xbe) VDPDataPort;
 
-const uint8_t patterns[] = {
-
-    /* Public-domain 8x8 font from https://github.com/dhepper/font8x8 */
-
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* U+0020 (space) */
-    0x18, 0x3c, 0x3c, 0x18, 0x18, 0x00, 0x18, 0x00,  /* U+0021 (!) */
-    0x6c, 0x6c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* U+0022 (") */
-    0x6c, 0x6c, 0xfe, 0x6c, 0xfe, 0x6c, 0x6c, 0x00,  /* U+0023 (#) */
-    0x30, 0x7c, 0xc0, 0x78, 0x0c, 0xf8, 0x30, 0x00,  /* U+0024 ($) */
-    0x00, 0xc6, 0xcc, 0x18, 0x30, 0x66, 0xc6, 0x00,  /* U+0025 (%) */
-    0x38, 0x6c, 0x38, 0x76, 0xdc, 0xcc, 0x76, 0x00,  /* U+0026 (&) */
-    0x60, 0x60, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00,  /* U+0027 (') */
-    0x18, 0x30, 0x60, 0x60, 0x60, 0x30, 0x18, 0x00,  /* U+0028 (() */
-    0x60, 0x30, 0x18, 0x18, 0x18, 0x30, 0x60, 0x00,  /* U+0029 ()) */
-    0x00, 0x66, 0x3c, 0xff, 0x3c, 0x66, 0x00, 0x00,  /* U+002A (*) */
-    0x00, 0x30, 0x30, 0xfc, 0x30, 0x30, 0x00, 0x00,  /* U+002B (+) */
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x60,  /* U+002C (,) */
-    0x00, 0x00, 0x00, 0xfc, 0x00, 0x00, 0x00, 0x00,  /* U+002D (-) */
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00,  /* U+002E (.) */
-    0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0, 0x80, 0x00,  /* U+002F (/) */
-    0x7c, 0xc6, 0xce, 0xde, 0xf6, 0xe6, 0x7c, 0x00,  /* U+0030 (0) */
-    0x30, 0x70, 0x30, 0x30, 0x30, 0x30, 0xfc, 0x00,  /* U+0031 (1) */
-    0x78, 0xcc, 0x0c, 0x38, 0x60, 0xcc, 0xfc, 0x00,  /* U+0032 (2) */
-    0x78, 0xcc, 0x0c, 0x38, 0x0c, 0xcc, 0x78, 0x00,  /* U+0033 (3) */
-    0x1c, 0x3c, 0x6c, 0xcc, 0xfe, 0x0c, 0x1e, 0x00,  /* U+0034 (4) */
-    0xfc, 0xc0, 0xf8, 0x0c, 0x0c, 0xcc, 0x78, 0x00,  /* U+0035 (5) */
-    0x38, 0x60, 0xc0, 0xf8, 0xcc, 0xcc, 0x78, 0x00,  /* U+0036 (6) */
-    0xfc, 0xcc, 0x0c, 0x18, 0x30, 0x30, 0x30, 0x00,  /* U+0037 (7) */
-    0x78, 0xcc, 0xcc, 0x78, 0xcc, 0xcc, 0x78, 0x00,  /* U+0038 (8) */
-    0x78, 0xcc, 0xcc, 0x7c, 0x0c, 0x18, 0x70, 0x00,  /* U+0039 (9) */
-    0x00, 0x30, 0x30, 0x00, 0x00, 0x30, 0x30, 0x00,  /* U+003A (:) */
-    0x00, 0x30, 0x30, 0x00, 0x00, 0x30, 0x30, 0x60,  /* U+003B (;) */
-    0x18, 0x30, 0x60, 0xc0, 0x60, 0x30, 0x18, 0x00,  /* U+003C (<) */
-    0x00, 0x00, 0xfc, 0x00, 0x00, 0xfc, 0x00, 0x00,  /* U+003D (=) */
-    0x60, 0x30, 0x18, 0x0c, 0x18, 0x30, 0x60, 0x00,  /* U+003E (>) */
-    0x78, 0xcc, 0x0c, 0x18, 0x30, 0x00, 0x30, 0x00,  /* U+003F (?) */
-    0x7c, 0xc6, 0xde, 0xde, 0xde, 0xc0, 0x78, 0x00,  /* U+0040 (@) */
-    0x30, 0x78, 0xcc, 0xcc, 0xfc, 0xcc, 0xcc, 0x00,  /* U+0041 (A) */
-    0xfc, 0x66, 0x66, 0x7c, 0x66, 0x66, 0xfc, 0x00,  /* U+0042 (B) */
-    0x3c, 0x66, 0xc0, 0xc0, 0xc0, 0x66, 0x3c, 0x00,  /* U+0043 (C) */
-    0xf8, 0x6c, 0x66, 0x66, 0x66, 0x6c, 0xf8, 0x00,  /* U+0044 (D) */
-    0xfe, 0x62, 0x68, 0x78, 0x68, 0x62, 0xfe, 0x00,  /* U+0045 (E) */
-    0xfe, 0x62, 0x68, 0x78, 0x68, 0x60, 0xf0, 0x00,  /* U+0046 (F) */
-    0x3c, 0x66, 0xc0, 0xc0, 0xce, 0x66, 0x3e, 0x00,  /* U+0047 (G) */
-    0xcc, 0xcc, 0xcc, 0xfc, 0xcc, 0xcc, 0xcc, 0x00,  /* U+0048 (H) */
-    0x78, 0x30, 0x30, 0x30, 0x30, 0x30, 0x78, 0x00,  /* U+0049 (I) */
-    0x1e, 0x0c, 0x0c, 0x0c, 0xcc, 0xcc, 0x78, 0x00,  /* U+004A (J) */
-    0xe6, 0x66, 0x6c, 0x78, 0x6c, 0x66, 0xe6, 0x00,  /* U+004B (K) */
-    0xf0, 0x60, 0x60, 0x60, 0x62, 0x66, 0xfe, 0x00,  /* U+004C (L) */
-    0xc6, 0xee, 0xfe, 0xfe, 0xd6, 0xc6, 0xc6, 0x00,  /* U+004D (M) */
-    0xc6, 0xe6, 0xf6, 0xde, 0xce, 0xc6, 0xc6, 0x00,  /* U+004E (N) */
-    0x38, 0x6c, 0xc6, 0xc6, 0xc6, 0x6c, 0x38, 0x00,  /* U+004F (O) */
-    0xfc, 0x66, 0x66, 0x7c, 0x60, 0x60, 0xf0, 0x00,  /* U+0050 (P) */
-    0x78, 0xcc, 0xcc, 0xcc, 0xdc, 0x78, 0x1c, 0x00,  /* U+0051 (Q) */
-    0xfc, 0x66, 0x66, 0x7c, 0x6c, 0x66, 0xe6, 0x00,  /* U+0052 (R) */
-    0x78, 0xcc, 0xe0, 0x70, 0x1c, 0xcc, 0x78, 0x00,  /* U+0053 (S) */
-    0xfc, 0xb4, 0x30, 0x30, 0x30, 0x30, 0x78, 0x00,  /* U+0054 (T) */
-    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xfc, 0x00,  /* U+0055 (U) */
-    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x78, 0x30, 0x00,  /* U+0056 (V) */
-    0xc6, 0xc6, 0xc6, 0xd6, 0xfe, 0xee, 0xc6, 0x00,  /* U+0057 (W) */
-    0xc6, 0xc6, 0x6c, 0x38, 0x38, 0x6c, 0xc6, 0x00,  /* U+0058 (X) */
-    0xcc, 0xcc, 0xcc, 0x78, 0x30, 0x30, 0x78, 0x00,  /* U+0059 (Y) */
-    0xfe, 0xc6, 0x8c, 0x18, 0x32, 0x66, 0xfe, 0x00,  /* U+005A (Z) */
-
-    /* Box drawing */
-    0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00,  /* Box h-line */
-    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,  /* Box v-line */
-    0x00, 0x00, 0x00, 0xc0, 0x20, 0x10, 0x10, 0x10,  /* Box tr-corner */
-    0x10, 0x10, 0x20, 0xc0, 0x00, 0x00, 0x00, 0x00,  /* Box br-corner */
-};
+SMS_EMBED_SEGA_ROM_HEADER (9999, 0);
 
 #define BOX_LINE_H    59
 #define BOX_LINE_V    60
 #define BOX_CORNER_TR 61
 #define BOX_CORNER_BR 62
 
+/*
+ * Call a function that lives in a ROM bank, mapping the
+ * bank into slot 2 for the duration of the call.
+ *
+ * Note: Must only be called from code in the fixed slots.
+ */
+void banked_call (uint8_t bank, void (*func) (void))
+{
+    SMS_saveROMBank ();
+    SMS_mapROMBank (bank);
+    func ();
+    SMS_restoreROMBank ();
+}
+
+
+/*
+ * Wait for the top of the active display, giving the
+ * caller a full frame to take a measurement in.
+ */
+void wait_for_active_display (void)
+{
+    SMS_waitForVBlank ();
+    while (SMS_getVCount () != 0);
+}
+
+
 void draw_string (int x, int y, char *string)
 {
     uint16_t name_table[32] = { 0 };
@@ -146,6 +108,32 @@ void clear_screen (void)
 }
 
 
+/*
+ * Load the static layout of a test screen, from tools/screengen.c.
+ * This replaces clear_screen, title_draw, and reference_draw, along
+ * with any fixed labels. The display is turned off so that the whole
+ * screen can be written in one burst.
+ */
+void screen_load (const uint8_t *screen)
+{
+    SMS_saveROMBank ();
+    SMS_mapROMBank (SCREENS_BANK);
+
+    SMS_waitForVBlank ();
+    SMS_displayOff ();
+
+    SMS_setAddr (XYtoADDR (0, 0));
+    for (uint16_t i = 0; i < SCREEN_SIZE; i++)
+    {
+        VDPDataPort = screen [i];
+        VDPDataPort = 0x00;
+    }
+
+    SMS_displayOn ();
+    SMS_restoreROMBank ();
+}
+
+
 /* Menu state */
 typedef struct menu_item_s {
     uint8_t type;
@@ -342,119 +330,149 @@ void menu_draw (void)
 }
 
 
+/* State for the menu being run */
+static void (*menu_func_current) (void) = NULL;
+static bool menu_cursor_changed = false;
+static uint8_t menu_repeat = 0;
+
+
 /*
- * Run a menu.
+ * VRAM job to update the menu during vblank.
  */
-void menu_run (void (*menu_func) (void))
+static void menu_update_job (void)
+{
+    menu_update (menu_cursor_changed);
+    menu_cursor_changed = false;
+}
+
+
+/*
+ * CPU job to handle menu input.
+ * Returns false once the user backs out of the menu.
+ */
+static bool menu_input_job (void)
 {
     uint16_t keys_pressed = 0;
     uint16_t keys_status = 0;
-    uint8_t repeat = 0;
     uint8_t cursor_store;
+    bool cursor_change = false;
 
-    menu_func ();
-    menu_draw ();
+    keys_pressed = SMS_getKeysPressed ();
+    keys_status = SMS_getKeysStatus ();
 
-    while (true)
+    /* Common menu controls: Up, Down, & Back */
+    if (keys_pressed & PORT_A_KEY_UP)
     {
-        bool cursor_change = false;
-
-        SMS_waitForVBlank ();
-        keys_pressed = SMS_getKeysPressed ();
-        keys_status = SMS_getKeysStatus ();
-
-        /* Common menu controls: Up, Down, & Back */
-        if (keys_pressed & PORT_A_KEY_UP)
+        menu_cursor--;
+        if (menu_cursor > menu_len)
         {
-            menu_cursor--;
-            if (menu_cursor > menu_len)
-            {
-                menu_cursor = 0;
-            }
-            else
-            {
-                cursor_change = true;
-            }
+            menu_cursor = 0;
         }
-        else if (keys_pressed & PORT_A_KEY_DOWN)
+        else
         {
-            menu_cursor++;
-            if (menu_cursor >= menu_len)
-            {
-                menu_cursor = menu_len - 1;
-            }
-            {
-                cursor_change = true;
-            }
+            cursor_change = true;
         }
-        else if (keys_pressed & PORT_A_KEY_2)
+    }
+    else if (keys_pressed & PORT_A_KEY_DOWN)
+    {
+        menu_cursor++;
+        if (menu_cursor >= menu_len)
         {
-            return;
+            menu_cursor = menu_len - 1;
         }
+        {
+            cursor_change = true;
+        }
+    }
+    else if (keys_pressed & PORT_A_KEY_2)
+    {
+        return false;
+    }
 
-        /* Function items */
-        else if (menu [menu_cursor].type == MENU_ITEM_FUNCTION)
+    /* Function items */
+    else if (menu [menu_cursor].type == MENU_ITEM_FUNCTION)
+    {
+        if ((keys_pressed & PORT_A_KEY_1) && menu [menu_cursor].func)
         {
-            if ((keys_pressed & PORT_A_KEY_1) && menu [menu_cursor].func)
-            {
-                cursor_store = menu_cursor;
-                menu [menu_cursor].func ();
-                menu_func ();
-                menu_draw ();
-                menu_cursor = cursor_store;
-            }
+            cursor_store = menu_cursor;
+            sched_screen_enter ();
+            menu [menu_cursor].func ();
+            menu_func_current ();
+            menu_draw ();
+            sched_screen_leave ();
+            menu_cursor = cursor_store;
         }
+    }
 
-        /* Value items */
-        else if (menu [menu_cursor].type == MENU_ITEM_VALUE)
+    /* Value items */
+    else if (menu [menu_cursor].type == MENU_ITEM_VALUE)
+    {
+        bool value_change = false;
+
+        /* Change the value if one of the following are true:
+         * - Left/Right were just pressed
+         * - The repeat-rate timer has elapsed
+         * - Button '1' is being held (fast-scroll)
+         */
+        if ((keys_pressed & (PORT_A_KEY_LEFT | PORT_A_KEY_RIGHT)) ||
+            (menu_repeat >= REPEAT_RATE) ||
+            (keys_status & PORT_A_KEY_1))
         {
-            bool value_change = false;
-
-            /* Change the value if one of the following are true:
-             * - Left/Right were just pressed
-             * - The repeat-rate timer has elapsed
-             * - Button '1' is being held (fast-scroll)
-             */
-            if ((keys_pressed & (PORT_A_KEY_LEFT | PORT_A_KEY_RIGHT)) ||
-                (repeat >= REPEAT_RATE) ||
-                (keys_status & PORT_A_KEY_1))
+            value_change = true;
+            menu_repeat = 0;
+        }
+        menu_repeat++;
+
+        if (value_change)
+        {
+            if (keys_status & PORT_A_KEY_LEFT)
             {
-                value_change = true;
-                repeat = 0;
+                menu [menu_cursor].value--;
+                if (menu [menu_cursor].value > menu [menu_cursor].value_max)
+                {
+                    menu [menu_cursor].value = 0;
+                }
+                if (menu [menu_cursor].value_func)
+                {
+                    menu [menu_cursor].value_func (menu [menu_cursor].value);
+                }
             }
-            repeat++;
-
-            if (value_change)
+            else if (keys_status & PORT_A_KEY_RIGHT)
             {
-                if (keys_status & PORT_A_KEY_LEFT)
+                menu [menu_cursor].value++;
+                if (menu [menu_cursor].value > menu [menu_cursor].value_max)
                 {
-                    menu [menu_cursor].value--;
-                    if (menu [menu_cursor].value > menu [menu_cursor].value_max)
-                    {
-                        menu [menu_cursor].value = 0;
-                    }
-                    if (menu [menu_cursor].value_func)
-                    {
-                        menu [menu_cursor].value_func (menu [menu_cursor].value);
-                    }
+                    menu [menu_cursor].value = menu [menu_cursor].value_max;
                 }
-                else if (keys_status & PORT_A_KEY_RIGHT)
+                if (menu [menu_cursor].value_func)
                 {
-                    menu [menu_cursor].value++;
-                    if (menu [menu_cursor].value > menu [menu_cursor].value_max)
-                    {
-                        menu [menu_cursor].value = menu [menu_cursor].value_max;
-                    }
-                    if (menu [menu_cursor].value_func)
-                    {
-                        menu [menu_cursor].value_func (menu [menu_cursor].value);
-                    }
+                    menu [menu_cursor].value_func (menu [menu_cursor].value);
                 }
             }
         }
-
-        menu_update (cursor_change);
     }
+
+    menu_cursor_changed |= cursor_change;
+    sched_vram_queue (menu_update_job);
+
+    return true;
+}
+
+
+/*
+ * Run a menu.
+ */
+void menu_run (void (*menu_func) (void))
+{
+    void (*menu_func_previous) (void) = menu_func_current;
+
+    menu_func_current = menu_func;
+    menu_func ();
+    menu_draw ();
+
+    sched_run (menu_input_job);
+
+    menu_func_current = menu_func_previous;
 }
 
 
@@ -482,28 +500,59 @@ void draw_string_priority (int x, int y, char *string)
 }
 
 
+/*
+ * Each group of tests lives in its own ROM bank, which is
+ * only paged in once its entry is chosen from the main menu.
+ */
+static void input_menu_enter (void)
+{
+    banked_call (INPUT_TESTS_BANK, input_menu_run);
+}
+static void vdp_menu_enter (void)
+{
+    banked_call (VDP_TESTS_BANK, vdp_menu_run);
+}
+static void sound_menu_enter (void)
+{
+    banked_call (SOUND_TESTS_BANK, sound_menu_run);
+}
+
+
 /*
  * Main menu, shown to the user at startup.
  */
 void main_menu (void)
 {
     menu_new ("SNEPTEST SMS");
-    menu_item_add ("INPUT TESTS", input_menu_run);
-    menu_item_add ("VDP TESTS", vdp_menu_run);
+    menu_item_add ("INPUT TESTS", input_menu_enter);
+    menu_item_add ("VDP TESTS", vdp_menu_enter);
+    menu_item_add ("SOUND TESTS", sound_menu_enter);
+    menu_item_add ("SYSTEM TESTS", system_menu_run);
 }
 
 
-void main (void)
+/*
+ * Set the palette used for the menus.
+ */
+void palette_init (void)
 {
-    /* Initial setup */
     SMS_setBackdropColor (0);
     SMS_setSpritePaletteColor (0, 0x01);    /* Sprite 0: Dark red (backdrop) */
     SMS_setSpritePaletteColor (1, 0x0f);    /* Sprite 1: Yellow (text as sprite) */
     SMS_setBGPaletteColor (0, 0x01);        /* Background 0: Dark red */
     SMS_setBGPaletteColor (1, 0x3f);        /* Background 1: White (text) */
+}
+
+
+void main (void)
+{
+    /* Initial setup */
+    palette_init ();
 
-    SMS_load1bppTiles (patterns, 0, sizeof (patterns), 0, 1);
+    SMS_mapROMBank (FONT_BANK);
+    SMS_load1bppTiles (font_patterns, 0, FONT_PATTERNS_SIZE, 0, 1);
     clear_name_table ();
+    sched_init ();
 
     SMS_waitForVBlank ();
     SMS_displayOn ();
@@ -0,0 +1,86 @@
+/*
+ * Sneptest SMS - Map streaming
+ *
+ * Copies rows and columns of the large map from tools/mapgen.c into
+ * the name table. The map is spread across several ROM banks, so this
+ * lives in the fixed slots to page them into slot 2.
+ *
+ * Name table column is the map column modulo 32. Rows are placed by
+ * the caller, as the 28-row name table does not divide the map height.
+ *
+ * Writes are back-to-back, so these should only be called during
+ * vblank or with the display off.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "SMSlib.h"
+#include "sneptest.h"
+#include "map_stream.h"
+
+#include "map.h"
+
+__sfr __at (0xbe) VDPDataPort;
+
+static const uint8_t * const map_banks [MAP_BANKS] = { map_0, map_1, map_2, map_3 };
+
+
+/*
+ * Write 32 tiles of map row map_y, starting from map_x, into name
+ * table row nt_y. The write address wraps within the name table row.
+ */
+void map_row_write (uint8_t map_x, uint8_t map_y, uint8_t nt_y)
+{
+    const uint8_t *row;
+    uint8_t nt_x = map_x & 0x1f;
+
+    SMS_saveROMBank ();
+    SMS_mapROMBank (MAP_BANK + map_y / MAP_BANK_ROWS);
+    row = map_banks [map_y / MAP_BANK_ROWS] + (map_y % MAP_BANK_ROWS) * MAP_WIDTH;
+
+    SMS_setAddr (XYtoADDR (nt_x, nt_y));
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        if (nt_x == 32)
+        {
+            nt_x = 0;
+            SMS_setAddr (XYtoADDR (0, nt_y));
+        }
+        VDPDataPort = row [map_x++];
+        VDPDataPort = 0x00;
+        nt_x++;
+    }
+
+    SMS_restoreROMBank ();
+}
+
+
+/*
+ * Write 28 tiles of map column map_x, starting from map_y, into the
+ * name table starting at row nt_y. As the name table is row-major,
+ * each tile needs its own write address, 64 bytes after the last.
+ */
+void map_column_write (uint8_t map_x, uint8_t map_y, uint8_t nt_y)
+{
+    uint16_t addr = XYtoADDR (map_x & 0x1f, nt_y);
+
+    SMS_saveROMBank ();
+
+    for (uint8_t i = 0; i < 28; i++)
+    {
+        SMS_mapROMBank (MAP_BANK + map_y / MAP_BANK_ROWS);
+        SMS_setAddr (addr);
+        VDPDataPort = map_banks [map_y / MAP_BANK_ROWS] [(map_y % MAP_BANK_ROWS) * MAP_WIDTH + map_x];
+        VDPDataPort = 0x00;
+
+        map_y++;
+        addr += 64;
+        if (++nt_y == 28)
+        {
+            nt_y = 0;
+            addr = XYtoADDR (map_x & 0x1f, 0);
+        }
+    }
+
+    SMS_restoreROMBank ();
+}
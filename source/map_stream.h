@@ -0,0 +1,3 @@
+
+void map_row_write (uint8_t map_x, uint8_t map_y, uint8_t nt_y);
+void map_column_write (uint8_t map_x, uint8_t map_y, uint8_t nt_y);
@@ -0,0 +1,101 @@
+/*
+ * Sneptest SMS - Palette band
+ *
+ * Makes a burst of CRAM writes at the start of each line in a band
+ * of the active display, from the scheduler's line interrupt. As the
+ * values written are those already in CRAM, any visible change is an
+ * artefact of the writes.
+ *
+ * This lives in the fixed slots, as the interrupt handlers may run
+ * while any bank is mapped.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "SMSlib.h"
+#include "scheduler.h"
+#include "palette_band.h"
+
+__sfr __at (0x7e) VCounterPort;
+__sfr __at (0xbe) VDPDataPort;
+__sfr __at (0xbf) VDPControlPort;
+
+static const uint8_t *palette_band_palette = NULL;
+static uint8_t palette_band_writes_per_line = 0;
+static uint16_t palette_band_overruns = 0;
+
+
+/*
+ * Line interrupt hook, writing the band.
+ */
+static void palette_band_handler (void)
+{
+    uint8_t v_count = VCounterPort;
+    uint8_t index = 0;
+
+    /* The reload value also gives a second interrupt, further down the frame */
+    if (v_count >= PALETTE_BAND_LINE + PALETTE_BAND_LINES)
+    {
+        return;
+    }
+
+    for (uint8_t line = 0; line < PALETTE_BAND_LINES; line++)
+    {
+        /* Wait for the start of the next line */
+        while (VCounterPort == v_count);
+        v_count = VCounterPort;
+
+        VDPControlPort = index;
+        VDPControlPort = 0xc0;
+        for (uint8_t i = palette_band_writes_per_line; i; i--)
+        {
+            VDPDataPort = palette_band_palette [index];
+            index = (index + 1) & 0x1f;
+        }
+
+        /* Count any lines where the writes did not fit */
+        if (VCounterPort != v_count)
+        {
+            palette_band_overruns++;
+        }
+    }
+}
+
+
+/*
+ * Start writing the band each frame, with 32 entries from 'palette'.
+ */
+void palette_band_start (const uint8_t *palette, uint8_t writes_per_line)
+{
+    palette_band_palette = palette;
+    palette_band_writes_per_line = writes_per_line;
+    palette_band_overruns = 0;
+
+    sched_line_hook_set (palette_band_handler, PALETTE_BAND_LINE - 1);
+}
+
+
+/*
+ * Change the palette the band writes. This should match what is in
+ * CRAM, so call it in vblank, right after each upload.
+ */
+void palette_band_palette_set (const uint8_t *palette)
+{
+    __asm di __endasm;
+    palette_band_palette = palette;
+    __asm ei __endasm;
+}
+
+
+void palette_band_stop (void)
+{
+    sched_line_hook_set (NULL, SCHED_SLICE_LINES - 1);
+    palette_band_overruns = 0;
+}
+
+
+uint16_t palette_band_overruns_get (void)
+{
+    return palette_band_overruns;
+}
@@ -0,0 +1,9 @@
+
+/* Mid-frame CRAM writes are made across this band of lines */
+#define PALETTE_BAND_LINE   96
+#define PALETTE_BAND_LINES  32
+
+void palette_band_start (const uint8_t *palette, uint8_t writes_per_line);
+void palette_band_palette_set (const uint8_t *palette);
+void palette_band_stop (void);
+uint16_t palette_band_overruns_get (void);
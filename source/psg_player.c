@@ -0,0 +1,222 @@
+/*
+ * Sneptest SMS - PSG player
+ *
+ * Plays a stream of SN76489 register writes, one frame at a time.
+ * The stream is run from the frame interrupt, or from a line
+ * interrupt part-way down the active display.
+ *
+ * Each update is timed using the V counter and the latched H counter,
+ * to measure the cost of the player and the jitter in when its first
+ * write lands. Timings are only valid while the update stays clear of
+ * the V counter's jump at the end of the frame.
+ *
+ * This lives in the fixed slots, as the interrupt handlers may run
+ * while any bank is mapped. The stream's bank is mapped for each
+ * update, as a game's music driver would.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "SMSlib.h"
+#include "sneptest.h"
+#include "scheduler.h"
+#include "psg_player.h"
+
+/* Line on which to run the update, in line interrupt mode */
+#define PSG_LINE        96
+
+/* Bits for port 0x3f: Port A TH as an output, with its level low or high */
+#define IO_TH_A_LOW     0xdd
+#define IO_TH_A_HIGH    0xfd
+#define IO_DEFAULT      0xff
+
+__sfr __at (0x3f) IOControlPort;
+__sfr __at (0x7e) VCounterPort;
+__sfr __at (0x7f) HCounterPort;
+__sfr __at (0x7f) PSGPort;
+
+static uint8_t psg_bank = 0;
+static const uint8_t *psg_stream = NULL;
+static const uint8_t *psg_position = NULL;
+
+static psg_stats psg_stats_current;
+
+
+/*
+ * Latch the time within the frame, as the raw V counter in the high
+ * byte and H counter in the low byte. Only the latch is done here,
+ * so that the conversion is kept out of the timed window.
+ */
+static uint16_t psg_time_latch (void)
+{
+    uint8_t h;
+    uint8_t v;
+
+    IOControlPort = IO_TH_A_LOW;
+    IOControlPort = IO_TH_A_HIGH;
+    h = HCounterPort;
+    v = VCounterPort;
+    IOControlPort = IO_DEFAULT;
+
+    return ((uint16_t) v << 8) | h;
+}
+
+
+/*
+ * Convert a latched time to CPU cycles. The H counter is latched by
+ * a rising edge on TH, and has a jump from 0x93 to 0xe9 to remove.
+ * One H counter step is two pixels, or 4/3 of a CPU cycle.
+ */
+static uint16_t psg_time_cycles (uint16_t latch)
+{
+    uint8_t h = latch & 0xff;
+    uint8_t v = latch >> 8;
+
+    if (h > 0x93)
+    {
+        h -= 0xe9 - 0x94;
+    }
+
+    return (uint16_t) v * CYCLES_PER_LINE + (h * 4) / 3;
+}
+
+
+/*
+ * Run one frame of the stream.
+ */
+static void psg_player_update (void)
+{
+    uint16_t start = psg_time_latch ();
+    uint16_t first = 0;
+    uint16_t end;
+    uint16_t time;
+    uint8_t writes = 0;
+    uint8_t command;
+
+    SMS_saveROMBank ();
+    SMS_mapROMBank (psg_bank);
+
+    while (true)
+    {
+        command = *psg_position++;
+
+        if (command == PSG_CMD_WRITE)
+        {
+            if (writes == 0)
+            {
+                first = psg_time_latch ();
+            }
+            PSGPort = *psg_position++;
+            writes++;
+        }
+        else if (command == PSG_CMD_END)
+        {
+            psg_position = psg_stream;
+        }
+        else
+        {
+            /* PSG_CMD_FRAME, or anything not understood */
+            break;
+        }
+    }
+
+    SMS_restoreROMBank ();
+    end = psg_time_latch ();
+
+    psg_stats_current.writes = writes;
+    psg_stats_current.cycles = psg_time_cycles (end) - psg_time_cycles (start);
+    if (psg_stats_current.cycles > psg_stats_current.cycles_peak)
+    {
+        psg_stats_current.cycles_peak = psg_stats_current.cycles;
+    }
+
+    if (writes)
+    {
+        time = psg_time_cycles (first);
+        if (time < psg_stats_current.write_first)
+        {
+            psg_stats_current.write_first = time;
+        }
+        if (time > psg_stats_current.write_last)
+        {
+            psg_stats_current.write_last = time;
+        }
+    }
+}
+
+
+/*
+ * With the line interrupt reload set to PSG_LINE - 1, the hook runs
+ * twice per frame. Only the first is used.
+ */
+static void psg_player_line_hook (void)
+{
+    if (VCounterPort < PSG_LINE)
+    {
+        psg_player_update ();
+    }
+}
+
+
+/*
+ * Mute all four channels.
+ */
+void psg_silence (void)
+{
+    PSGPort = 0x9f;
+    PSGPort = 0xbf;
+    PSGPort = 0xdf;
+    PSGPort = 0xff;
+}
+
+
+/*
+ * Start playing a stream from a ROM bank, from either the frame
+ * interrupt or the line interrupt. Resets the statistics.
+ */
+void psg_player_start (uint8_t bank, const uint8_t *stream, bool line_interrupt)
+{
+    psg_player_stop ();
+
+    psg_bank = bank;
+    psg_stream = stream;
+    psg_position = stream;
+
+    psg_stats_current.cycles = 0;
+    psg_stats_current.cycles_peak = 0;
+    psg_stats_current.writes = 0;
+    psg_stats_current.write_first = UINT16_MAX;
+    psg_stats_current.write_last = 0;
+
+    if (line_interrupt)
+    {
+        sched_line_hook_set (psg_player_line_hook, PSG_LINE - 1);
+    }
+    else
+    {
+        sched_frame_hook_set (psg_player_update);
+    }
+}
+
+
+/*
+ * Stop the player and restore the scheduler's defaults.
+ */
+void psg_player_stop (void)
+{
+    sched_frame_hook_set (NULL);
+    sched_line_hook_set (NULL, SCHED_SLICE_LINES - 1);
+    psg_silence ();
+}
+
+
+/*
+ * Copy out the statistics, without the interrupt changing them part-way.
+ */
+void psg_stats_get (psg_stats *stats)
+{
+    __asm di __endasm;
+    *stats = psg_stats_current;
+    __asm ei __endasm;
+}
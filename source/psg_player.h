@@ -0,0 +1,18 @@
+
+/* Stream commands, a subset of VGM */
+#define PSG_CMD_WRITE   0x50    /* Followed by one byte for the PSG */
+#define PSG_CMD_FRAME   0x62    /* End of this frame's writes */
+#define PSG_CMD_END     0x66    /* End of stream, loop to the start */
+
+typedef struct psg_stats_s {
+    uint16_t cycles;        /* Cost of the last update */
+    uint16_t cycles_peak;
+    uint8_t writes;         /* Writes in the last update */
+    uint16_t write_first;   /* Earliest and latest time of the first write, */
+    uint16_t write_last;    /* in cycles from the start of the frame */
+} psg_stats;
+
+void psg_player_start (uint8_t bank, const uint8_t *stream, bool line_interrupt);
+void psg_player_stop (void);
+void psg_stats_get (psg_stats *stats);
+void psg_silence (void);
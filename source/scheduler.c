@@ -0,0 +1,225 @@
+/*
+ * Sneptest SMS - Scheduler
+ *
+ * A small cooperative scheduler for screens that run once per frame.
+ *
+ * VRAM jobs are queued up during the frame, and run at the start of
+ * the next vblank. The screen's CPU job (input and logic) then runs
+ * during the active display.
+ *
+ * Time is measured with the V counter, along with slices counted by
+ * a line interrupt every SCHED_SLICE_LINES lines of the active display:
+ *  - VRAM jobs have a budget of the vblank period. If the active
+ *    display has started by the time they complete, it counts as
+ *    an overrun.
+ *  - CPU jobs have a budget of SCHED_CPU_BUDGET_LINES. Exceeding this,
+ *    or running into the next vblank, counts as an overrun.
+ *
+ * The line interrupt stays enabled for the whole ROM, so any test
+ * that times a loop with interrupts enabled will include its cost.
+ *
+ * This lives in the fixed slots, as the interrupt handlers may run
+ * while any bank is mapped.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "SMSlib.h"
+#include "scheduler.h"
+
+#define SCHED_VRAM_QUEUE_SIZE   8
+#define SCHED_CPU_BUDGET_LINES  176
+
+/* Lowest V counter value during vblank, after the PAL jump */
+#define SCHED_VBLANK_V_COUNT_MIN 0xba
+
+volatile uint8_t sched_frame_count = 0;
+volatile uint16_t sched_line_count = 0;
+static volatile uint8_t sched_slice = 0;
+static void (*sched_line_hook) (void) = NULL;
+static void (*sched_frame_hook) (void) = NULL;
+
+static void (*sched_vram_queue_jobs [SCHED_VRAM_QUEUE_SIZE]) (void);
+static uint8_t sched_vram_queue_len = 0;
+
+/* Counts the screens entered and left, to detect nested screens */
+static uint8_t sched_run_count = 0;
+
+static uint16_t sched_vram_overruns = 0;
+static uint16_t sched_cpu_overruns = 0;
+
+
+static void sched_frame_handler (void)
+{
+    sched_frame_count++;
+    sched_slice = 0;
+    if (sched_frame_hook)
+    {
+        sched_frame_hook ();
+    }
+}
+
+
+static void sched_line_handler (void)
+{
+    sched_line_count++;
+    sched_slice++;
+    if (sched_line_hook)
+    {
+        sched_line_hook ();
+    }
+}
+
+
+/*
+ * Install the interrupt handlers. Called once at startup.
+ */
+void sched_init (void)
+{
+    SMS_setFrameInterruptHandler (sched_frame_handler);
+    SMS_setLineInterruptHandler (sched_line_handler);
+    SMS_setLineCounter (SCHED_SLICE_LINES - 1);
+    SMS_enableLineInterrupt ();
+}
+
+
+/*
+ * Allow a test to run its own code from the line interrupt, with
+ * its own reload value.
+ * Pass NULL and SCHED_SLICE_LINES - 1 to restore the default.
+ */
+void sched_line_hook_set (void (*hook) (void), uint8_t reload)
+{
+    __asm di __endasm;
+    sched_line_hook = hook;
+    __asm ei __endasm;
+
+    SMS_setLineCounter (reload);
+}
+
+
+/*
+ * Allow a test to run its own code from the frame interrupt.
+ * Pass NULL to remove it.
+ */
+void sched_frame_hook_set (void (*hook) (void))
+{
+    __asm di __endasm;
+    sched_frame_hook = hook;
+    __asm ei __endasm;
+}
+
+
+/*
+ * Queue a job to run during the next vblank. Jobs
+ * already in the queue are not added a second time.
+ */
+void sched_vram_queue (void (*job) (void))
+{
+    for (uint8_t i = 0; i < sched_vram_queue_len; i++)
+    {
+        if (sched_vram_queue_jobs [i] == job)
+        {
+            return;
+        }
+    }
+
+    if (sched_vram_queue_len < SCHED_VRAM_QUEUE_SIZE)
+    {
+        sched_vram_queue_jobs [sched_vram_queue_len++] = job;
+    }
+}
+
+
+/*
+ * Check if the active display has started since the vblank in which
+ * 'frame' was counted. On PAL, the V counter jumps back to 0xba during
+ * vblank, so lines 186 to 191 of the next frame can only be told apart
+ * by the slices that have elapsed by then.
+ */
+bool sched_vblank_ended (uint8_t frame)
+{
+    return sched_frame_count != frame ||
+           sched_slice != 0 ||
+           SMS_getVCount () < SCHED_VBLANK_V_COUNT_MIN;
+}
+
+
+/*
+ * Mark the start and end of a nested screen that runs its own frame
+ * loop from inside a CPU job, so that its time is not counted as an
+ * overrun of the job that started it. sched_run does this itself.
+ */
+void sched_screen_enter (void)
+{
+    sched_run_count++;
+}
+
+
+void sched_screen_leave (void)
+{
+    sched_run_count++;
+}
+
+
+/*
+ * Run a screen. Each frame, the queued VRAM jobs are run in vblank,
+ * followed by the CPU job. Returns once the CPU job returns false.
+ */
+void sched_run (bool (*cpu_job) (void))
+{
+    uint8_t run_count;
+    uint8_t frame;
+
+    sched_screen_enter ();
+
+    while (true)
+    {
+        SMS_waitForVBlank ();
+        frame = sched_frame_count;
+
+        /* VRAM jobs */
+        for (uint8_t i = 0; i < sched_vram_queue_len; i++)
+        {
+            sched_vram_queue_jobs [i] ();
+        }
+        sched_vram_queue_len = 0;
+
+        if (sched_vblank_ended (frame))
+        {
+            sched_vram_overruns++;
+        }
+
+        /* CPU job */
+        run_count = sched_run_count;
+        if (!cpu_job ())
+        {
+            break;
+        }
+
+        /* Don't count the time spent in a nested screen */
+        if (sched_run_count == run_count &&
+            (sched_frame_count != frame ||
+             (sched_vblank_ended (frame) && SMS_getVCount () >= SCHED_CPU_BUDGET_LINES)))
+        {
+            sched_cpu_overruns++;
+        }
+    }
+
+    /* Discard anything left for this screen */
+    sched_vram_queue_len = 0;
+    sched_screen_leave ();
+}
+
+
+uint16_t sched_vram_overruns_get (void)
+{
+    return sched_vram_overruns;
+}
+
+
+uint16_t sched_cpu_overruns_get (void)
+{
+    return sched_cpu_overruns;
+}
@@ -0,0 +1,16 @@
+
+#define SCHED_SLICE_LINES 16
+
+extern volatile uint8_t sched_frame_count;
+extern volatile uint16_t sched_line_count;
+
+void sched_init (void);
+void sched_line_hook_set (void (*hook) (void), uint8_t reload);
+void sched_frame_hook_set (void (*hook) (void));
+void sched_vram_queue (void (*job) (void));
+bool sched_vblank_ended (uint8_t frame);
+void sched_screen_enter (void);
+void sched_screen_leave (void);
+void sched_run (bool (*cpu_job) (void));
+uint16_t sched_vram_overruns_get (void);
+uint16_t sched_cpu_overruns_get (void);
@@ -1,7 +1,25 @@
 
 #define REPEAT_RATE 20
 
+/* ROM banks, paged into slot 2. These must match build.sh */
+#define FONT_BANK           2
+#define INPUT_TESTS_BANK    3
+#define VDP_TESTS_BANK      4
+#define TEST_PATTERNS_BANK  5
+#define MAP_BANK            6   /* First of MAP_BANKS */
+#define SOUND_TESTS_BANK    10
+#define SCREENS_BANK        11
+
+/* Approximate CPU cycles per scanline */
+#define CYCLES_PER_LINE 228
+
+void banked_call (uint8_t bank, void (*func) (void));
+void wait_for_active_display (void);
+void palette_init (void);
+
+void clear_name_table (void);
 void clear_screen (void);
+void screen_load (const uint8_t *screen);
 void draw_string (int x, int y, char *string);
 void reference_draw (char *text);
 void title_draw (char *title);
@@ -0,0 +1,525 @@
+/*
+ * Sneptest SMS - Sound tests
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "SMSlib.h"
+#include "sneptest.h"
+#include "scheduler.h"
+#include "psg_player.h"
+
+#include "screens.h"
+
+__sfr __at (0x7f) PSGPort;
+__sfr __at (0x3e) MemoryControlPort;
+__sfr __at (0xf2) AudioControlPort;
+
+/* Memory control, as left by the BIOS */
+#define MemoryControlSaved          (*(volatile uint8_t *) 0xc000)
+#define MEMORY_CONTROL_CARTRIDGE    0xab
+#define MEMORY_CONTROL_IO_DISABLE   0x04
+#define FM_DETECT_PROBES            8
+
+/* Tone dividers, for the NTSC clock */
+#define C3  855
+#define F3  641
+#define G3  571
+#define A3  508
+#define C4  428
+#define E4  339
+#define F4  320
+#define G4  285
+#define A4  254
+#define B4  226
+#define C5  214
+#define D5  191
+#define F5  160
+#define G5  143
+#define A2  1017
+
+/* Stream authoring, see psg_player.h for the commands */
+#define PSG_WRITE(d)            PSG_CMD_WRITE, (d)
+#define PSG_TONE(ch, div)       PSG_WRITE (0x80 | ((ch) << 5) | ((div) & 0x0f)), PSG_WRITE (((div) >> 4) & 0x3f)
+#define PSG_VOLUME(ch, att)     PSG_WRITE (0x90 | ((ch) << 5) | (att))
+#define PSG_NOISE(mode)         PSG_WRITE (0xe0 | (mode))
+
+/* One arpeggio note on channel 0, decaying over eight frames, with
+ * a bass note on channel 1 and a noise hit on channel 3. */
+#define PSG_STEP(note, bass) \
+    PSG_TONE (0, note), PSG_VOLUME (0, 0), PSG_TONE (1, bass), PSG_VOLUME (1, 2), \
+    PSG_NOISE (0x04), PSG_VOLUME (3, 4), PSG_CMD_FRAME, \
+    PSG_VOLUME (0, 1), PSG_VOLUME (3, 8), PSG_CMD_FRAME, \
+    PSG_VOLUME (0, 2), PSG_VOLUME (1, 3), PSG_VOLUME (3, 15), PSG_CMD_FRAME, \
+    PSG_VOLUME (0, 3), PSG_CMD_FRAME, \
+    PSG_VOLUME (0, 4), PSG_VOLUME (1, 4), PSG_CMD_FRAME, \
+    PSG_VOLUME (0, 5), PSG_CMD_FRAME, \
+    PSG_VOLUME (0, 6), PSG_VOLUME (1, 5), PSG_CMD_FRAME, \
+    PSG_VOLUME (0, 8), PSG_CMD_FRAME
+
+/* C, Am, F, G */
+static const uint8_t psg_tune [] = {
+    PSG_STEP (C4, C3), PSG_STEP (E4, C3), PSG_STEP (G4, C3), PSG_STEP (C5, C3),
+    PSG_STEP (A3, A2), PSG_STEP (C4, A2), PSG_STEP (E4, A2), PSG_STEP (A4, A2),
+    PSG_STEP (F4, F3), PSG_STEP (A4, F3), PSG_STEP (C5, F3), PSG_STEP (F5, F3),
+    PSG_STEP (G4, G3), PSG_STEP (B4, G3), PSG_STEP (D5, G3), PSG_STEP (G5, G3),
+    PSG_CMD_END
+};
+
+/* PSG tone test state */
+static uint8_t psg_channel = 0;
+
+/* PSG player test state */
+static bool psg_line_interrupt = false;
+static psg_stats psg_stats_shown;
+
+
+/*
+ * Play a tone on one channel, with the others muted.
+ */
+static void psg_channel_play (uint8_t channel)
+{
+    psg_silence ();
+
+    if (channel == 3)
+    {
+        PSGPort = 0xe4;
+    }
+    else
+    {
+        PSGPort = 0x80 | (channel << 5) | (A4 & 0x0f);
+        PSGPort = (A4 >> 4) & 0x3f;
+    }
+    PSGPort = 0x90 | (channel << 5);
+}
+
+
+/*
+ * VRAM job to show the selected channel.
+ */
+static void psg_tone_render (void)
+{
+    static char * const channel_names [4] = { "TONE 0 ", "TONE 1 ", "TONE 2 ", "NOISE  " };
+
+    draw_string (16, 12, channel_names [psg_channel]);
+}
+
+
+/*
+ * CPU job for the PSG tone test.
+ */
+static bool psg_tone_input (void)
+{
+    uint16_t pressed = SMS_getKeysPressed ();
+
+    if (pressed & PORT_A_KEY_2)
+    {
+        return false;
+    }
+
+    if (pressed & (PORT_A_KEY_LEFT | PORT_A_KEY_RIGHT))
+    {
+        if (pressed & PORT_A_KEY_LEFT)  psg_channel--;
+        if (pressed & PORT_A_KEY_RIGHT) psg_channel++;
+        psg_channel &= 0x03;
+
+        psg_channel_play (psg_channel);
+        sched_vram_queue (psg_tone_render);
+    }
+
+    return true;
+}
+
+
+/*
+ * Test for each PSG channel, playing an A4 or white noise.
+ */
+static void psg_tone_test (void)
+{
+    screen_load (screen_psg_tones);
+
+    psg_channel_play (psg_channel);
+    sched_vram_queue (psg_tone_render);
+    sched_run (psg_tone_input);
+
+    psg_silence ();
+}
+
+
+/*
+ * VRAM job to show the player statistics.
+ */
+static void psg_player_render (void)
+{
+    char string_buf[6] = { '\0' };
+
+    draw_string (18, 6, psg_line_interrupt ? "LINE  " : "FRAME ");
+
+    sprintf (string_buf, "%5u", psg_stats_shown.cycles);
+    draw_string (18, 9, string_buf);
+    sprintf (string_buf, "%5u", psg_stats_shown.cycles_peak);
+    draw_string (18, 11, string_buf);
+    sprintf (string_buf, "%5u", (psg_stats_shown.cycles_peak + CYCLES_PER_LINE - 1) / CYCLES_PER_LINE);
+    draw_string (18, 13, string_buf);
+    sprintf (string_buf, "%5u", psg_stats_shown.writes);
+    draw_string (18, 15, string_buf);
+
+    /* No writes measured yet */
+    if (psg_stats_shown.write_first > psg_stats_shown.write_last)
+    {
+        draw_string (18, 17, "    -");
+        draw_string (18, 19, "    -");
+        return;
+    }
+
+    sprintf (string_buf, "%5u", psg_stats_shown.write_first);
+    draw_string (18, 17, string_buf);
+    sprintf (string_buf, "%5u", psg_stats_shown.write_last - psg_stats_shown.write_first);
+    draw_string (18, 19, string_buf);
+}
+
+
+/*
+ * CPU job for the PSG player test.
+ */
+static bool psg_player_input (void)
+{
+    uint16_t pressed = SMS_getKeysPressed ();
+    psg_stats stats;
+
+    if (pressed & PORT_A_KEY_2)
+    {
+        return false;
+    }
+
+    if (pressed & PORT_A_KEY_1)
+    {
+        psg_line_interrupt = !psg_line_interrupt;
+        psg_player_start (SOUND_TESTS_BANK, psg_tune, psg_line_interrupt);
+    }
+
+    /* Only redraw when something has changed */
+    psg_stats_get (&stats);
+    if ((pressed & PORT_A_KEY_1) ||
+        stats.cycles != psg_stats_shown.cycles ||
+        stats.cycles_peak != psg_stats_shown.cycles_peak ||
+        stats.writes != psg_stats_shown.writes ||
+        stats.write_first != psg_stats_shown.write_first ||
+        stats.write_last != psg_stats_shown.write_last)
+    {
+        psg_stats_shown = stats;
+        sched_vram_queue (psg_player_render);
+    }
+
+    return true;
+}
+
+
+/*
+ * Benchmark for a PSG register-stream player, run from either the
+ * frame interrupt or a line interrupt. Shows the cost of each update,
+ * and the jitter in the time of the first write of each frame.
+ */
+static void psg_player_test (void)
+{
+    screen_load (screen_psg_player);
+
+    psg_player_start (SOUND_TESTS_BANK, psg_tune, psg_line_interrupt);
+    psg_stats_get (&psg_stats_shown);
+
+    sched_vram_queue (psg_player_render);
+    sched_run (psg_player_input);
+
+    psg_player_stop ();
+}
+
+
+/* FM test state. Delays are in NOPs, see fm_write_burst */
+#define FM_DELAY_MAX        64
+#define FM_CHANNELS         9
+#define FM_COST_UPDATES_MAX 16
+static bool fm_present = false;
+static uint8_t fm_address_delay = 16;
+static uint8_t fm_data_delay = 16;
+static const uint8_t *fm_burst = NULL;
+static uint8_t fm_burst_count = 0;
+static uint8_t fm_update [FM_CHANNELS * 3 * 2];
+static uint16_t fm_update_cycles = 0;
+
+/* Chord for the play test, as block, F-number, and instrument */
+static const uint8_t fm_chord_block [FM_CHANNELS] = { 3, 3, 3, 4, 4, 4, 2, 2, 5 };
+static const uint16_t fm_chord_fnum [FM_CHANNELS] = { 172, 217, 258, 172, 217, 258, 172, 258, 172 };
+static const uint8_t fm_chord_instrument [FM_CHANNELS] = { 3, 3, 3, 11, 11, 11, 14, 14, 1 };
+
+/* Melody mode, with all nine channels */
+static const uint8_t fm_rhythm_off [2] = { 0x0e, 0x00 };
+
+
+/*
+ * Write fm_burst_count register / value pairs from fm_burst.
+ *
+ * The delays are made by jumping into a sled of NOPs, so that each
+ * adds 4 cycles. From one address write to its data write is then
+ * 23 + 4 * fm_address_delay cycles, and from a data write to the
+ * next address write is 59 + 4 * fm_data_delay cycles.
+ */
+static void fm_write_burst (void) __naked
+{
+    __asm
+        push    ix
+        push    iy
+
+        ; ix = end of the address sled, less the delay
+        ld      hl, #00102$
+        ld      a, (_fm_address_delay)
+        ld      e, a
+        ld      d, #0
+        or      a
+        sbc     hl, de
+        push    hl
+        pop     ix
+
+        ; iy = end of the data sled, less the delay
+        ld      hl, #00103$
+        ld      a, (_fm_data_delay)
+        ld      e, a
+        or      a
+        sbc     hl, de
+        push    hl
+        pop     iy
+
+        ld      hl, (_fm_burst)
+        ld      a, (_fm_burst_count)
+        ld      b, a
+
+    00101$:
+        ld      a, (hl)
+        inc     hl
+        ld      c, (hl)
+        inc     hl
+        out     (#0xf0), a
+        jp      (ix)
+        .rept   64      ; FM_DELAY_MAX
+        nop
+        .endm
+    00102$:
+        ld      a, c
+        out     (#0xf1), a
+        jp      (iy)
+        .rept   64      ; FM_DELAY_MAX
+        nop
+        .endm
+    00103$:
+        dec     b
+        jp      nz, 00101$
+
+        pop     iy
+        pop     ix
+        ret
+    __endasm;
+}
+
+
+/*
+ * Detect the FM unit. Only bit 0 of the audio control port is
+ * guaranteed to read back, and only when the FM unit is present.
+ * The I/O chip is disabled while probing so that the joypad
+ * ports cannot drive the bus. The BIOS leaves its last write to
+ * the memory control port at 0xc000; without a BIOS, use the
+ * value a cartridge boots with.
+ */
+static bool fm_detect (void)
+{
+    uint8_t memory_control = MemoryControlSaved;
+    uint8_t matches = 0;
+
+    if (memory_control == 0x00)
+    {
+        memory_control = MEMORY_CONTROL_CARTRIDGE;
+    }
+
+    __asm di __endasm;
+    MemoryControlPort = memory_control | MEMORY_CONTROL_IO_DISABLE;
+
+    for (uint8_t i = 0; i < FM_DETECT_PROBES; i++)
+    {
+        AudioControlPort = i & 0x01;
+        if ((AudioControlPort & 0x07) == (i & 0x01))
+        {
+            matches++;
+        }
+    }
+    AudioControlPort = 0x00;
+
+    MemoryControlPort = memory_control;
+    __asm ei __endasm;
+
+    return matches == FM_DETECT_PROBES;
+}
+
+
+/*
+ * Fill fm_update with the instrument and frequency
+ * registers for all nine channels.
+ */
+static void fm_update_build (bool key_on)
+{
+    uint8_t *pair = fm_update;
+
+    for (uint8_t ch = 0; ch < FM_CHANNELS; ch++)
+    {
+        *pair++ = 0x30 + ch;
+        *pair++ = fm_chord_instrument [ch] << 4;
+        *pair++ = 0x10 + ch;
+        *pair++ = fm_chord_fnum [ch] & 0xff;
+        *pair++ = 0x20 + ch;
+        *pair++ = (key_on ? 0x10 : 0x00) | (fm_chord_block [ch] << 1) | (fm_chord_fnum [ch] >> 8);
+    }
+}
+
+
+static void fm_write (const uint8_t *pairs, uint8_t count)
+{
+    fm_burst = pairs;
+    fm_burst_count = count;
+    fm_write_burst ();
+}
+
+
+/*
+ * Time a full nine channel update with the current delays. As many
+ * updates as will fit are run from the top of the active display.
+ */
+static void fm_update_cost_measure (void)
+{
+    uint8_t updates = 0;
+    uint8_t lines;
+
+    fm_update_build (false);
+
+    wait_for_active_display ();
+    __asm di __endasm;
+    do
+    {
+        fm_write (fm_update, FM_CHANNELS * 3);
+        updates++;
+    } while (SMS_getVCount () < 128 && updates < FM_COST_UPDATES_MAX);
+    lines = SMS_getVCount ();
+    __asm ei __endasm;
+
+    fm_update_cycles = ((uint16_t) lines * CYCLES_PER_LINE) / updates;
+}
+
+
+/*
+ * Play the chord for a moment, with the current delays. Any writes
+ * lost by the FM chip will be heard as wrong notes or instruments.
+ */
+static void fm_play_test (void)
+{
+    fm_write (fm_rhythm_off, 1);
+
+    fm_update_build (false);
+    fm_write (fm_update, FM_CHANNELS * 3);
+    fm_update_build (true);
+    fm_write (fm_update, FM_CHANNELS * 3);
+
+    for (uint8_t i = 0; i < 90; i++)
+    {
+        SMS_waitForVBlank ();
+    }
+
+    fm_update_build (false);
+    fm_write (fm_update, FM_CHANNELS * 3);
+
+    fm_update_cost_measure ();
+}
+
+
+static void fm_address_delay_set (uint16_t value)
+{
+    fm_address_delay = value;
+    fm_update_cost_measure ();
+}
+
+
+static void fm_data_delay_set (uint16_t value)
+{
+    fm_data_delay = value;
+    fm_update_cost_measure ();
+}
+
+
+static uint16_t fm_present_get (void)
+{
+    return fm_present;
+}
+
+
+static uint16_t fm_address_cycles_get (void)
+{
+    return 23 + 4 * fm_address_delay;
+}
+
+
+static uint16_t fm_data_cycles_get (void)
+{
+    return 59 + 4 * fm_data_delay;
+}
+
+
+static uint16_t fm_update_cycles_get (void)
+{
+    return fm_update_cycles;
+}
+
+
+/*
+ * Test for YM2413 register write timing. The delays after the address
+ * and data writes can be lowered until the chord no longer plays
+ * correctly, to find the minimum that the hardware accepts.
+ */
+static void fm_menu (void)
+{
+    menu_new ("FM SOUND");
+    menu_item_add_show_uint ("FM UNIT DETECTED", fm_present_get);
+    menu_item_add_value ("ADDRESS DELAY", fm_address_delay, FM_DELAY_MAX, fm_address_delay_set);
+    menu_item_add_value ("DATA DELAY", fm_data_delay, FM_DELAY_MAX, fm_data_delay_set);
+    menu_item_add_show_uint ("ADDRESS CYCLES", fm_address_cycles_get);
+    menu_item_add_show_uint ("DATA CYCLES", fm_data_cycles_get);
+    menu_item_add ("PLAY TEST CHORD", fm_play_test);
+    menu_item_add_show_uint ("9 CH UPDATE CYCLES", fm_update_cycles_get);
+}
+static void fm_test (void)
+{
+    fm_present = fm_detect ();
+    if (fm_present)
+    {
+        AudioControlPort = 0x01;
+    }
+
+    fm_update_cost_measure ();
+    menu_run (fm_menu);
+
+    if (fm_present)
+    {
+        AudioControlPort = 0x00;
+    }
+}
+
+
+/*
+ * Sound test submenu
+ */
+static void sound_menu (void)
+{
+    menu_new ("SOUND TESTS");
+    menu_item_add ("PSG TONES", psg_tone_test);
+    menu_item_add ("PSG PLAYER", psg_player_test);
+    menu_item_add ("FM SOUND", fm_test);
+}
+void sound_menu_run (void)
+{
+    menu_run (sound_menu);
+}
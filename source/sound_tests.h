@@ -0,0 +1,2 @@
+
+void sound_menu_run (void);
@@ -0,0 +1,174 @@
+/*
+ * Sneptest SMS - System tests
+ *
+ * Unlike the other test groups, these live in the fixed slots,
+ * as the bank-switch benchmark needs to re-map slot 2 while it
+ * is running.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "SMSlib.h"
+#include "sneptest.h"
+#include "scheduler.h"
+
+#define BANK_SWITCH_ITERATIONS 128
+
+/* Mapper writes per iteration, so that the whole-line timing
+ * resolution is spread across 1024 writes */
+#define MAPPER_WRITES_PER_ITERATION 8
+
+static uint16_t mapper_write_cycles = 0;
+static uint16_t banked_call_cycles = 0;
+
+static void (*bank_switch_target) (void) = NULL;
+
+
+static void bank_switch_empty (void)
+{
+}
+
+
+/*
+ * Each loop runs for BANK_SWITCH_ITERATIONS, starting at the top
+ * of the active display, and returns the number of lines taken.
+ * Interrupts are disabled so the scheduler's slices are not timed.
+ *
+ * As the timing is in whole lines, each reading is only accurate to
+ * CYCLES_PER_LINE cycles in total. The mapper loop makes several
+ * writes per iteration to bring this below a cycle per write. A
+ * banked call is slow enough that a fit within one frame allows
+ * only one per iteration, so it is accurate to a few cycles.
+ */
+static uint8_t bank_switch_loop_empty (void)
+{
+    uint8_t lines;
+
+    wait_for_active_display ();
+    __asm di __endasm;
+    for (uint8_t i = 0; i < BANK_SWITCH_ITERATIONS; i++)
+    {
+        __asm nop __endasm;
+    }
+    lines = SMS_getVCount ();
+    __asm ei __endasm;
+    return lines;
+}
+
+
+static uint8_t bank_switch_loop_map (void)
+{
+    uint8_t lines;
+
+    wait_for_active_display ();
+    __asm di __endasm;
+    for (uint8_t i = 0; i < BANK_SWITCH_ITERATIONS; i++)
+    {
+        __asm nop __endasm;
+        SMS_mapROMBank (FONT_BANK);
+        SMS_mapROMBank (FONT_BANK);
+        SMS_mapROMBank (FONT_BANK);
+        SMS_mapROMBank (FONT_BANK);
+        SMS_mapROMBank (FONT_BANK);
+        SMS_mapROMBank (FONT_BANK);
+        SMS_mapROMBank (FONT_BANK);
+        SMS_mapROMBank (FONT_BANK);
+    }
+    lines = SMS_getVCount ();
+    __asm ei __endasm;
+    return lines;
+}
+
+
+static uint8_t bank_switch_loop_direct_call (void)
+{
+    uint8_t lines;
+
+    wait_for_active_display ();
+    __asm di __endasm;
+    for (uint8_t i = 0; i < BANK_SWITCH_ITERATIONS; i++)
+    {
+        bank_switch_target ();
+    }
+    lines = SMS_getVCount ();
+    __asm ei __endasm;
+    return lines;
+}
+
+
+static uint8_t bank_switch_loop_banked_call (void)
+{
+    uint8_t lines;
+
+    wait_for_active_display ();
+    __asm di __endasm;
+    for (uint8_t i = 0; i < BANK_SWITCH_ITERATIONS; i++)
+    {
+        banked_call (FONT_BANK, bank_switch_target);
+    }
+    lines = SMS_getVCount ();
+    __asm ei __endasm;
+    return lines;
+}
+
+
+/*
+ * Measure the cost of bank switching, as the difference between
+ * each loop and the same loop without the bank switch.
+ */
+static void bank_switch_benchmark (void)
+{
+    uint8_t empty_lines;
+    uint8_t map_lines;
+    uint8_t direct_lines;
+    uint8_t banked_lines;
+    SMS_saveROMBank ();
+
+    bank_switch_target = bank_switch_empty;
+
+    empty_lines = bank_switch_loop_empty ();
+    map_lines = bank_switch_loop_map ();
+    direct_lines = bank_switch_loop_direct_call ();
+    banked_lines = bank_switch_loop_banked_call ();
+
+    SMS_restoreROMBank ();
+
+    /* Rounded to the nearest cycle */
+    mapper_write_cycles = ((uint16_t) (map_lines - empty_lines) * CYCLES_PER_LINE +
+                           BANK_SWITCH_ITERATIONS * MAPPER_WRITES_PER_ITERATION / 2) /
+                          (BANK_SWITCH_ITERATIONS * MAPPER_WRITES_PER_ITERATION);
+    banked_call_cycles = ((uint16_t) (banked_lines - direct_lines) * CYCLES_PER_LINE +
+                          BANK_SWITCH_ITERATIONS / 2) / BANK_SWITCH_ITERATIONS;
+}
+
+
+static uint16_t mapper_write_cycles_get (void)
+{
+    return mapper_write_cycles;
+}
+
+
+static uint16_t banked_call_cycles_get (void)
+{
+    return banked_call_cycles;
+}
+
+
+/*
+ * System test submenu
+ */
+static void system_menu (void)
+{
+    menu_new ("SYSTEM TESTS");
+    menu_item_add ("REPEAT BENCHMARK", bank_switch_benchmark);
+    menu_item_add_show_uint ("MAPPER WRITE CYCLES", mapper_write_cycles_get);
+    menu_item_add_show_uint ("BANKED CALL CYCLES", banked_call_cycles_get);
+    menu_item_add_show_uint ("VRAM JOB OVERRUNS", sched_vram_overruns_get);
+    menu_item_add_show_uint ("CPU JOB OVERRUNS", sched_cpu_overruns_get);
+}
+void system_menu_run (void)
+{
+    bank_switch_benchmark ();
+    menu_run (system_menu);
+}
@@ -0,0 +1,2 @@
+
+void system_menu_run (void);
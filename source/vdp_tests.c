@@ -7,179 +7,435 @@
 #include <stdio.h>
 #include "SMSlib.h"
 #include "sneptest.h"
-
+#include "scheduler.h"
+#include "vram_stream.h"
+#include "hud.h"
+#include "map_stream.h"
+#include "palette_band.h"
+#include "vdp_timing_tests.h"
+
+#include "gradient.h"
+#include "checkerboard.h"
+#include "alignment_grid.h"
+#include "map.h"
+#include "screens.h"
+
+__sfr __at (0xbe) VDPDataPort;
+
+/* Line interrupt test state, as of the last reading */
 static uint16_t line_interrupt_count = 0;
+static uint8_t line_interrupt_frame = 0;
+
+/* Scroll test state */
+static uint8_t scroll_x = 0;
+static uint8_t scroll_y = 0;
+static uint8_t scroll_repeat = 0;
+static uint8_t scroll_x_value = 0;
+static uint8_t scroll_y_value = 0;
+
+/* Map streaming state. The camera position is in pixels, with the
+ * vertical position wrapping at 7 map heights, the first multiple
+ * of the 224-line name table height. */
+#define STREAM_Y_WRAP       (7 * MAP_HEIGHT * 8)
+#define STREAM_ROW_WRAP     (STREAM_Y_WRAP / 8)
+#define STREAM_WINDOW       64
+static bool stream_enabled = false;
+static uint16_t stream_x = 0;
+static uint16_t stream_y = 0;
+static uint8_t stream_column_left = 0;
+static uint8_t stream_column_right = 0;
+static uint16_t stream_row_top = 0;
+static uint16_t stream_row_bottom = 0;
+static bool stream_column_pending = false;
+static bool stream_row_pending = false;
+static uint8_t stream_column = 0;
+static uint16_t stream_row = 0;
+
+/* Tile writes, for the last frame, the peak, and the last STREAM_WINDOW frames */
+static uint8_t stream_writes = 0;
+static uint8_t stream_writes_peak = 0;
+static uint8_t stream_writes_history [STREAM_WINDOW];
+static uint8_t stream_writes_index = 0;
+static uint16_t stream_writes_window = 0;
+static uint8_t stream_writes_value = 0;
+static uint8_t stream_peak_value = 0;
+static uint8_t stream_window_value = 0;
+
 
 /*
- * Test for VDP scrolling behaviour.
+ * VRAM job to write any newly exposed map row and column
+ * and show the tile write counts.
  */
-static void vdp_scroll_test (void)
+static void vdp_stream_render (void)
 {
-    uint16_t pressed = 0;
-    uint8_t scroll_x = 0;
-    uint8_t scroll_y = 0;
-    uint8_t repeat = 0;
-    char string_buf[3] = { '\0' };
+    SMS_setBGScrollX (-stream_x);
+    SMS_setBGScrollY (stream_y % 224);
+
+    if (stream_column_pending)
+    {
+        map_column_write (stream_column, stream_row_top, stream_row_top % 28);
+        stream_column_pending = false;
+    }
+    if (stream_row_pending)
+    {
+        map_row_write (stream_column_left, stream_row, stream_row % 28);
+        stream_row_pending = false;
+    }
+
+    hud_update ();
+}
 
-    clear_screen ();
-    title_draw ("VDP SCROLLING");
-    reference_draw ("    1: FAST-SCROLL    2: BACK   ");
 
-    draw_string (10, 12,  "SCROLL X:");
-    draw_string (10, 14,  "SCROLL Y:");
+/*
+ * Move the camera one pixel in each pressed direction, and note
+ * any map row or column that has come into view.
+ */
+static void vdp_stream_move (uint16_t pressed)
+{
+    uint8_t column_left, column_right;
+    uint16_t row_top, row_bottom;
 
-    while (!(pressed & PORT_A_KEY_2))
+    if (pressed & PORT_A_KEY_UP)
     {
-        bool move = false;
-        SMS_waitForVBlank ();
+        stream_y = (stream_y == 0) ? STREAM_Y_WRAP - 1 : stream_y - 1;
+    }
+    if (pressed & PORT_A_KEY_DOWN)
+    {
+        stream_y = (stream_y == STREAM_Y_WRAP - 1) ? 0 : stream_y + 1;
+    }
+    if (pressed & PORT_A_KEY_LEFT)
+    {
+        stream_x = (stream_x - 1) & (MAP_WIDTH * 8 - 1);
+    }
+    if (pressed & PORT_A_KEY_RIGHT)
+    {
+        stream_x = (stream_x + 1) & (MAP_WIDTH * 8 - 1);
+    }
 
-        SMS_setBGScrollX (scroll_x);
-        SMS_setBGScrollY (scroll_y);
+    /* The left column is blanked, leaving 248 visible pixels */
+    column_left = (stream_x + 8) >> 3;
+    column_right = (stream_x + 255) >> 3;
+    row_top = stream_y >> 3;
+    row_bottom = ((stream_y + 191) >> 3) % STREAM_ROW_WRAP;
 
-        /* Render during vblank */
-        sprintf (string_buf, "%02X", scroll_x);
-        draw_string (20, 12, string_buf);
-        sprintf (string_buf, "%02X", scroll_y);
-        draw_string (20, 14, string_buf);
+    /* Only the leading edge needs writing, the trailing edge is already in the name table */
+    if ((pressed & PORT_A_KEY_RIGHT) && column_right != stream_column_right)
+    {
+        stream_column = column_right;
+        stream_column_pending = true;
+    }
+    else if ((pressed & PORT_A_KEY_LEFT) && column_left != stream_column_left)
+    {
+        stream_column = column_left;
+        stream_column_pending = true;
+    }
 
-        /* Input handling */
-        pressed = SMS_getKeysStatus ();
+    if ((pressed & PORT_A_KEY_DOWN) && row_bottom != stream_row_bottom)
+    {
+        stream_row = row_bottom;
+        stream_row_pending = true;
+    }
+    else if ((pressed & PORT_A_KEY_UP) && row_top != stream_row_top)
+    {
+        stream_row = row_top;
+        stream_row_pending = true;
+    }
 
-        /* Respond instantly when the direction first goes down */
-        if (SMS_getKeysPressed () & (PORT_A_KEY_UP | PORT_A_KEY_DOWN | PORT_A_KEY_LEFT | PORT_A_KEY_RIGHT))
-        {
-            move = true;
-        }
+    stream_column_left = column_left;
+    stream_column_right = column_right;
+    stream_row_top = row_top;
+    stream_row_bottom = row_bottom;
+}
 
-        /* Rate-limited repeat if the button is held down */
-        if (repeat >= REPEAT_RATE)
-        {
-            move = true;
-        }
 
-        /* Fast move if button 1 is held down */
-        if (pressed & PORT_A_KEY_1)
-        {
-            move = true;
-        }
+/*
+ * Record the tile writes needed for this frame.
+ */
+static void vdp_stream_count (void)
+{
+    uint8_t writes = 0;
 
-        if (move)
-        {
-            repeat = 0;
-            if (pressed & PORT_A_KEY_UP)    scroll_y++;
-            if (pressed & PORT_A_KEY_DOWN)  scroll_y--;
-            if (pressed & PORT_A_KEY_LEFT)  scroll_x--;
-            if (pressed & PORT_A_KEY_RIGHT) scroll_x++;
-        }
+    if (stream_column_pending)
+    {
+        writes += 28;
+    }
+    if (stream_row_pending)
+    {
+        writes += 32;
+    }
+
+    stream_writes_window -= stream_writes_history [stream_writes_index];
+    stream_writes_window += writes;
+    stream_writes_history [stream_writes_index] = writes;
+    stream_writes_index = (stream_writes_index + 1) % STREAM_WINDOW;
 
-        repeat++;
+    if (writes > stream_writes_peak)
+    {
+        stream_writes_peak = writes;
     }
 
-    SMS_setBGScrollX (0);
-    SMS_setBGScrollY (0);
+    stream_writes = writes;
+    hud_value_set (stream_writes_value, stream_writes);
+    hud_value_set (stream_peak_value, stream_writes_peak);
+    hud_value_set (stream_window_value, stream_writes_window);
+
+    /* The window total changes most frames, so always redraw */
+    sched_vram_queue (vdp_stream_render);
 }
 
 
 /*
- * Test for sprite behaviour.
+ * VRAM job to apply the scroll values and show them.
  */
-static void vdp_sprite_test (void)
+static void vdp_scroll_render (void)
 {
-    char string_buf[3] = { '\0' };
-    uint8_t sprite_x = 128;
-    uint8_t sprite_y = 96;
-    signed char sprite_index = 0;
+    SMS_setBGScrollX (scroll_x);
+    SMS_setBGScrollY (scroll_y);
+    hud_update ();
+}
 
-    clear_screen ();
-    title_draw ("VDP SPRITES");
-    reference_draw ("      1: SLOW       2: BACK     ");
 
-    draw_string (10, 12,  "SPRITE X:");
-    draw_string (10, 14,  "SPRITE Y:");
+/*
+ * CPU job for the scroll test input handling.
+ */
+static bool vdp_scroll_input (void)
+{
+    uint16_t pressed = SMS_getKeysStatus ();
+    bool move = false;
 
-    SMS_useFirstHalfTilesforSprites (true);
+    if (pressed & PORT_A_KEY_2)
+    {
+        return false;
+    }
 
-    SMS_initSprites();
-    sprite_index = SMS_addSprite (sprite_x, sprite_y, '#' - ' ');
-    SMS_finalizeSprites();
+    /* Respond instantly when the direction first goes down */
+    if (SMS_getKeysPressed () & (PORT_A_KEY_UP | PORT_A_KEY_DOWN | PORT_A_KEY_LEFT | PORT_A_KEY_RIGHT))
+    {
+        move = true;
+    }
 
-    while (true)
+    /* Rate-limited repeat if the button is held down */
+    if (scroll_repeat >= REPEAT_RATE)
     {
-        unsigned int pressed;
-        SMS_waitForVBlank ();
+        move = true;
+    }
 
-        /* Render during vblank */
-        sprintf (string_buf, "%02X", sprite_x);
-        draw_string (22, 12, string_buf);
-        sprintf (string_buf, "%02X", sprite_y);
-        draw_string (22, 14, string_buf);
-        SMS_updateSpritePosition (sprite_index, sprite_x, sprite_y);
-        SMS_copySpritestoSAT ();
+    /* Fast move if button 1 is held down */
+    if (pressed & PORT_A_KEY_1)
+    {
+        move = true;
+    }
 
-        /* Input handling */
-        pressed = SMS_getKeysStatus ();
-        if (pressed & PORT_A_KEY_1)
-            pressed = SMS_getKeysPressed ();
+    if (move && stream_enabled)
+    {
+        scroll_repeat = 0;
+        vdp_stream_move (pressed);
+    }
+    else if (move)
+    {
+        scroll_repeat = 0;
+        if (pressed & PORT_A_KEY_UP)    scroll_y++;
+        if (pressed & PORT_A_KEY_DOWN)  scroll_y--;
+        if (pressed & PORT_A_KEY_LEFT)  scroll_x--;
+        if (pressed & PORT_A_KEY_RIGHT) scroll_x++;
+        hud_value_set (scroll_x_value, scroll_x);
+        hud_value_set (scroll_y_value, scroll_y);
+        sched_vram_queue (vdp_scroll_render);
+    }
 
-        if (pressed & PORT_A_KEY_UP)
-        {
-            sprite_y--;
-        }
-        if (pressed & PORT_A_KEY_DOWN)
-        {
-            sprite_y++;
-        }
-        if (pressed & PORT_A_KEY_LEFT)
-        {
-            sprite_x--;
-        }
-        if (pressed & PORT_A_KEY_RIGHT)
-        {
-            sprite_x++;
-        }
-        if (pressed & PORT_A_KEY_2)     break;
+    if (stream_enabled)
+    {
+        vdp_stream_count ();
+    }
+
+    scroll_repeat++;
+
+    return true;
+}
+
+
+/*
+ * Test for VDP scrolling behaviour.
+ */
+static void vdp_scroll_test (void)
+{
+    scroll_x = 0;
+    scroll_y = 0;
+    scroll_repeat = 0;
+    stream_enabled = false;
+
+    screen_load (screen_vdp_scroll);
+
+    /* Values are sprites, so stay in place while scrolling */
+    hud_reset ();
+    scroll_x_value = hud_value_add (160,  96, 2, false);
+    scroll_y_value = hud_value_add (160, 112, 2, false);
+
+    sched_vram_queue (vdp_scroll_render);
+    sched_run (vdp_scroll_input);
+
+    SMS_setBGScrollX (0);
+    SMS_setBGScrollY (0);
+    hud_reset ();
+}
+
+
+/*
+ * Scrolling test over a large map, streaming the newly exposed
+ * row and column into the name table. Shows the number of tile
+ * writes needed, to measure the cost of a scrolling game world.
+ */
+static void vdp_stream_test (void)
+{
+    scroll_repeat = 0;
+    stream_enabled = true;
+    stream_x = 0;
+    stream_y = 0;
+    stream_column_left = 1;
+    stream_column_right = 31;
+    stream_row_top = 0;
+    stream_row_bottom = 23;
+    stream_column_pending = false;
+    stream_row_pending = false;
+    stream_writes = 0;
+    stream_writes_peak = 0;
+    stream_writes_index = 0;
+    stream_writes_window = 0;
+    for (uint8_t i = 0; i < STREAM_WINDOW; i++)
+    {
+        stream_writes_history [i] = 0;
     }
 
-    SMS_initSprites ();
-    SMS_finalizeSprites ();
-    SMS_copySpritestoSAT ();
+    /* Fill the name table from the map, with the display off */
+    SMS_waitForVBlank ();
+    SMS_displayOff ();
+    for (uint8_t row = 0; row < 28; row++)
+    {
+        map_row_write (stream_column_left, row, row);
+    }
+    SMS_VDPturnOnFeature (VDPFEATURE_LEFTCOLBLANK);
+    SMS_displayOn ();
+
+    hud_reset ();
+    hud_label_add (16, 16, "NOW");
+    stream_writes_value = hud_value_add (56, 16, 3, true);
+    hud_label_add (16, 26, "PEAK");
+    stream_peak_value = hud_value_add (56, 26, 3, true);
+    hud_label_add (16, 36, "64F");
+    stream_window_value = hud_value_add (48, 36, 4, true);
+
+    sched_vram_queue (vdp_stream_render);
+    sched_run (vdp_scroll_input);
+
+    SMS_waitForVBlank ();
+    hud_reset ();
+    SMS_VDPturnOffFeature (VDPFEATURE_LEFTCOLBLANK);
+    SMS_setBGScrollX (0);
+    SMS_setBGScrollY (0);
+    stream_enabled = false;
+
+    /* The map leaves tiles in the rows and columns the menu does not redraw */
+    clear_name_table ();
 }
 
 
+/* Sprite test state */
+static uint8_t sprite_x = 128;
+static uint8_t sprite_y = 96;
+static uint8_t sprite_index = 0;
+static uint8_t sprite_x_value = 0;
+static uint8_t sprite_y_value = 0;
+
+
+/*
+ * CPU job for the sprite test input handling.
+ */
+static bool vdp_sprite_input (void)
+{
+    unsigned int pressed;
+
+    pressed = SMS_getKeysStatus ();
+    if (pressed & PORT_A_KEY_1)
+        pressed = SMS_getKeysPressed ();
+
+    if (pressed & PORT_A_KEY_UP)
+    {
+        sprite_y--;
+    }
+    if (pressed & PORT_A_KEY_DOWN)
+    {
+        sprite_y++;
+    }
+    if (pressed & PORT_A_KEY_LEFT)
+    {
+        sprite_x--;
+    }
+    if (pressed & PORT_A_KEY_RIGHT)
+    {
+        sprite_x++;
+    }
+    if (pressed & PORT_A_KEY_2)     return false;
+
+    if (pressed & (PORT_A_KEY_UP | PORT_A_KEY_DOWN | PORT_A_KEY_LEFT | PORT_A_KEY_RIGHT))
+    {
+        hud_sprite_move (sprite_index, sprite_x, sprite_y);
+        hud_value_set (sprite_x_value, sprite_x);
+        hud_value_set (sprite_y_value, sprite_y);
+        sched_vram_queue (hud_update);
+    }
+
+    return true;
+}
 
 
 /*
- * Increment the line interrupt counter.
+ * Test for sprite behaviour.
  */
-static void vdp_interrupt_test_handler (void)
+static void vdp_sprite_test (void)
 {
-    line_interrupt_count++;
+    sprite_x = 128;
+    sprite_y = 96;
+
+    screen_load (screen_vdp_sprite);
+
+    hud_reset ();
+    sprite_index = hud_sprite_add (sprite_x, sprite_y, '#' - ' ');
+    sprite_x_value = hud_value_add (176,  96, 2, false);
+    sprite_y_value = hud_value_add (176, 112, 2, false);
+    hud_value_set (sprite_x_value, sprite_x);
+    hud_value_set (sprite_y_value, sprite_y);
+
+    sched_vram_queue (hud_update);
+    sched_run (vdp_sprite_input);
+
+    hud_reset ();
 }
 
 
+/*
+ * Average the count over the frames since the last call, in
+ * case a vblank was missed while responding to user input.
+ */
 static uint16_t vdp_line_interrupt_count_get (void)
 {
-    uint16_t ret = line_interrupt_count;
-    line_interrupt_count = 0;
+    uint8_t frames = sched_frame_count - line_interrupt_frame;
+    uint16_t count = sched_line_count - line_interrupt_count;
+    uint16_t ret = frames ? count / frames : count;
+
+    line_interrupt_count += count;
+    line_interrupt_frame += frames;
     return ret;
 }
 
 
 static void vdp_line_interrupt_reload_set (uint16_t value)
 {
-    SMS_setLineCounter (value);
+    sched_line_hook_set (NULL, value);
 }
 
 
 /*
  * Test the line interrupt behaviour.
- *
- * Note: Responding to user input can keep us busy enough
- *       to miss a vblank. This can cause two frames worth
- *       of interrupts to be shown while actively scrolling.
- *
- *       To get a more reliable value, perhaps we need a
- *       custom frame interrupt handler...
  */
 static void vdp_line_interrupt_menu (void)
 {
@@ -189,13 +445,13 @@ static void vdp_line_interrupt_menu (void)
 }
 static void vdp_line_interrupt_test (void)
 {
-    SMS_setLineInterruptHandler (vdp_interrupt_test_handler);
-    SMS_setLineCounter (0x80);
-    SMS_enableLineInterrupt();
+    line_interrupt_frame = sched_frame_count;
+    line_interrupt_count = sched_line_count;
+    sched_line_hook_set (NULL, 0x80);
 
     menu_run (vdp_line_interrupt_menu);
 
-    SMS_disableLineInterrupt();
+    sched_line_hook_set (NULL, SCHED_SLICE_LINES - 1);
     SMS_setBackdropColor (0);
 }
 
@@ -238,6 +494,436 @@ static void vdp_background_test (void)
 }
 
 
+typedef struct test_pattern_s {
+    const uint8_t *tiles;
+    const uint8_t *tilemap;
+    uint16_t base_tile;
+    uint16_t size;
+    uint8_t palette [16];
+} test_pattern;
+
+static const test_pattern test_patterns [] = {
+    { gradient_tiles, gradient_tilemap, GRADIENT_BASE_TILE, GRADIENT_SIZE, GRADIENT_PALETTE },
+    { checkerboard_tiles, checkerboard_tilemap, CHECKERBOARD_BASE_TILE, CHECKERBOARD_SIZE, CHECKERBOARD_PALETTE },
+    { alignment_grid_tiles, alignment_grid_tilemap, ALIGNMENT_GRID_BASE_TILE, ALIGNMENT_GRID_SIZE, ALIGNMENT_GRID_PALETTE },
+};
+
+#define TEST_PATTERN_BUDGET_UNIT 32
+
+static uint16_t test_pattern_budget = 0;
+static uint16_t test_pattern_bytes_per_frame = 0;
+static uint16_t test_pattern_frames = 0;
+static uint16_t test_pattern_overruns = 0;
+
+
+/*
+ * Measure how many bytes can be decompressed in one frame with
+ * the display off, by repeatedly streaming the tiles until the
+ * V-counter wraps back to the top of the frame.
+ *
+ * The scheduler's line interrupt should be disabled by the caller,
+ * leaving only the frame interrupt's cost in the measurement.
+ * Interrupts cannot be disabled entirely, as SMS_setAddr enables them.
+ */
+static void vdp_test_pattern_measure (const test_pattern *pattern)
+{
+    vram_stream stream;
+    uint8_t v_count;
+    uint8_t v_count_prev = 0;
+    uint16_t bytes = 0;
+
+    vram_stream_init (&stream, TEST_PATTERNS_BANK, pattern->tiles, 0x4000 | (pattern->base_tile << 5));
+    wait_for_active_display ();
+
+    while (true)
+    {
+        if (stream.done)
+        {
+            vram_stream_init (&stream, TEST_PATTERNS_BANK, pattern->tiles, 0x4000 | (pattern->base_tile << 5));
+        }
+        bytes += vram_stream_step (&stream, 16);
+
+        v_count = SMS_getVCount ();
+        if ((v_count_prev & 0x80) && !(v_count & 0x80))
+        {
+            break;
+        }
+        v_count_prev = v_count;
+    }
+
+    test_pattern_bytes_per_frame = bytes;
+}
+
+
+/*
+ * Stream the whole pattern in, either with the display off, or in
+ * chunks of the chosen budget during each vblank.
+ *
+ * Note: The window is shared, so the tilemap stream is only
+ *       started once the tiles stream is complete.
+ */
+static void vdp_test_pattern_load (const test_pattern *pattern)
+{
+    const uint8_t *sources [2] = { pattern->tiles, pattern->tilemap };
+    uint16_t dests [2] = { 0x4000 | (pattern->base_tile << 5), SMS_PNTAddress };
+    uint16_t budget = test_pattern_budget * TEST_PATTERN_BUDGET_UNIT;
+    uint16_t chunks;
+    vram_stream stream;
+    uint8_t v_count;
+    uint8_t v_count_prev;
+    uint8_t frame;
+    uint8_t i = 0;
+
+    test_pattern_frames = 1;
+    test_pattern_overruns = 0;
+
+    SMS_waitForVBlank ();
+    SMS_loadBGPalette (pattern->palette);
+
+    if (budget == 0)
+    {
+        SMS_displayOff ();
+        SMS_disableLineInterrupt ();
+        vdp_test_pattern_measure (pattern);
+
+        v_count_prev = SMS_getVCount ();
+        for (i = 0; i < 2; i++)
+        {
+            vram_stream_init (&stream, TEST_PATTERNS_BANK, sources [i], dests [i]);
+            while (!stream.done)
+            {
+                vram_stream_step (&stream, 16);
+
+                v_count = SMS_getVCount ();
+                if ((v_count_prev & 0x80) && !(v_count & 0x80))
+                {
+                    test_pattern_frames++;
+                }
+                v_count_prev = v_count;
+            }
+        }
+
+        SMS_enableLineInterrupt ();
+        SMS_displayOn ();
+        return;
+    }
+
+    /* One chunk of the budget per vblank, covering the tiles and tilemap */
+    chunks = (pattern->size + budget - 1) / budget;
+
+    vram_stream_init (&stream, TEST_PATTERNS_BANK, sources [0], dests [0]);
+    while (true)
+    {
+        uint16_t budget_left = budget;
+        frame = sched_frame_count;
+
+        while (budget_left && i < 2)
+        {
+            uint16_t written = vram_stream_step (&stream, budget_left);
+            budget_left -= written;
+
+            if (stream.done && ++i < 2)
+            {
+                vram_stream_init (&stream, TEST_PATTERNS_BANK, sources [i], dests [i]);
+            }
+        }
+
+        /* The chunk should be complete before the active display starts */
+        if (sched_vblank_ended (frame))
+        {
+            test_pattern_overruns++;
+        }
+
+        if (--chunks == 0)
+        {
+            return;
+        }
+
+        SMS_waitForVBlank ();
+        test_pattern_frames++;
+    }
+}
+
+
+/*
+ * Show a full-screen test pattern until button 2 is pressed.
+ */
+static void vdp_test_pattern_show (uint8_t index)
+{
+    vdp_test_pattern_load (&test_patterns [index]);
+
+    do {
+        SMS_waitForVBlank ();
+    } while (!(SMS_getKeysPressed () & PORT_A_KEY_2));
+
+    SMS_waitForVBlank ();
+    palette_init ();
+}
+static void vdp_test_pattern_gradient (void)
+{
+    vdp_test_pattern_show (0);
+}
+static void vdp_test_pattern_checkerboard (void)
+{
+    vdp_test_pattern_show (1);
+}
+static void vdp_test_pattern_alignment_grid (void)
+{
+    vdp_test_pattern_show (2);
+}
+
+
+static void vdp_test_pattern_budget_set (uint16_t value)
+{
+    test_pattern_budget = value;
+}
+
+
+static uint16_t vdp_test_pattern_bytes_per_frame_get (void)
+{
+    return test_pattern_bytes_per_frame;
+}
+
+
+static uint16_t vdp_test_pattern_frames_get (void)
+{
+    return test_pattern_frames;
+}
+
+
+static uint16_t vdp_test_pattern_overruns_get (void)
+{
+    return test_pattern_overruns;
+}
+
+
+/*
+ * Test loading compressed full-screen patterns into VRAM.
+ *
+ * With a budget of zero, the pattern is loaded with the display
+ * off, and the number of bytes that can be decompressed in a frame
+ * is measured. Otherwise, the budget is the number of 32-byte chunks
+ * to decompress during each vblank, and any chunk that does not
+ * finish before the active display starts is counted as an overrun.
+ */
+static void vdp_test_pattern_menu (void)
+{
+    menu_new ("VDP TEST PATTERNS");
+    menu_item_add ("GRADIENT RAMPS", vdp_test_pattern_gradient);
+    menu_item_add ("CHECKERBOARD", vdp_test_pattern_checkerboard);
+    menu_item_add ("ALIGNMENT GRID", vdp_test_pattern_alignment_grid);
+    menu_item_add_value ("VBLANK BUDGET", test_pattern_budget, 0x10, vdp_test_pattern_budget_set);
+    menu_item_add_show_uint ("BYTES PER FRAME", vdp_test_pattern_bytes_per_frame_get);
+    menu_item_add_show_uint ("LOAD FRAMES", vdp_test_pattern_frames_get);
+    menu_item_add_show_uint ("VBLANK OVERRUNS", vdp_test_pattern_overruns_get);
+}
+static void vdp_test_pattern_test (void)
+{
+    menu_run (vdp_test_pattern_menu);
+}
+
+
+/* Solid tiles of each colour, for drawing the palette bars */
+#define PALETTE_TILE_BASE 256
+
+/* Number of full 32-entry uploads made during each vblank */
+#define PALETTE_UPLOAD_REPEAT 4
+
+/* Frames to hold each fade level for */
+#define PALETTE_FADE_RATE 8
+
+static const uint8_t palette_base [32] = {
+    /* Background: Menu colours, followed by a spread of hues */
+    0x01, 0x3f, 0x03, 0x07, 0x0b, 0x0f, 0x0e, 0x0c,
+    0x1c, 0x3c, 0x38, 0x34, 0x30, 0x31, 0x33, 0x2a,
+    /* Sprites: Menu colours, followed by grey and channel ramps */
+    0x01, 0x0f, 0x15, 0x2a, 0x3f, 0x01, 0x02, 0x03,
+    0x04, 0x08, 0x0c, 0x10, 0x20, 0x30, 0x00, 0x3f,
+};
+
+/* Each level subtracts one more from each colour channel, clamping at zero */
+static const uint8_t palette_fade_table [4] [64] = {
+    /* Level 0 */
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+        0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+        0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+    },
+    /* Level 1 */
+    {
+        0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x01, 0x02, 0x04, 0x04, 0x05, 0x06, 0x08, 0x08, 0x09, 0x0a,
+        0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x01, 0x02, 0x04, 0x04, 0x05, 0x06, 0x08, 0x08, 0x09, 0x0a,
+        0x10, 0x10, 0x11, 0x12, 0x10, 0x10, 0x11, 0x12, 0x14, 0x14, 0x15, 0x16, 0x18, 0x18, 0x19, 0x1a,
+        0x20, 0x20, 0x21, 0x22, 0x20, 0x20, 0x21, 0x22, 0x24, 0x24, 0x25, 0x26, 0x28, 0x28, 0x29, 0x2a,
+    },
+    /* Level 2 */
+    {
+        0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x04, 0x04, 0x04, 0x05,
+        0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x04, 0x04, 0x04, 0x05,
+        0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x04, 0x04, 0x04, 0x05,
+        0x10, 0x10, 0x10, 0x11, 0x10, 0x10, 0x10, 0x11, 0x10, 0x10, 0x10, 0x11, 0x14, 0x14, 0x14, 0x15,
+    },
+    /* Level 3 */
+    {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    },
+};
+
+/* The palette last uploaded in vblank, for the band to rewrite, and
+ * the palette to upload in the next vblank. The next fade level is
+ * staged in whichever buffer is not in CRAM. */
+static uint8_t palette_buffers [2] [32];
+static uint8_t *palette_current = palette_buffers [0];
+static uint8_t *palette_next = palette_buffers [0];
+static uint8_t palette_writes_per_line = 0;
+
+
+/*
+ * Draw a bar with two cells of each colour from one palette.
+ */
+static void vdp_palette_bar_draw (uint8_t y, uint16_t palette_select)
+{
+    uint16_t name_table [32];
+
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        name_table [i] = palette_select | (PALETTE_TILE_BASE + (i >> 1));
+    }
+
+    SMS_loadTileMapArea (0, y, name_table, 32, 1);
+    SMS_loadTileMapArea (0, y + 1, name_table, 32, 1);
+}
+
+
+/*
+ * Stream the palette into CRAM, during vblank and mid-frame.
+ *
+ * With fade enabled, the vblank uploads step through the fade
+ * table. With writes-per-line set, the palette band rewrites
+ * that many CRAM entries on each line of the band.
+ */
+static void vdp_palette_stream (bool fade)
+{
+    char string_buf [8] = { '\0' };
+    uint16_t upload_cycles = 0;
+    uint8_t fade_level = 0;
+    int8_t fade_step = 1;
+    uint8_t fade_timer = 0;
+
+    screen_load (screen_vdp_palette);
+
+    /* Solid tiles, one per colour. Written at full speed, so blank the display */
+    SMS_waitForVBlank ();
+    SMS_displayOff ();
+    SMS_setAddr (0x4000 | (PALETTE_TILE_BASE << 5));
+    for (uint8_t colour = 0; colour < 16; colour++)
+    {
+        for (uint8_t row = 0; row < 8; row++)
+        {
+            for (uint8_t plane = 0; plane < 4; plane++)
+            {
+                VDPDataPort = (colour & (1 << plane)) ? 0xff : 0x00;
+            }
+        }
+    }
+    SMS_displayOn ();
+
+    vdp_palette_bar_draw (6, 0x0000);
+    vdp_palette_bar_draw (10, 0x0800);
+
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        palette_buffers [0] [i] = palette_base [i];
+    }
+    palette_current = palette_buffers [0];
+    palette_next = palette_buffers [0];
+
+    if (palette_writes_per_line)
+    {
+        palette_band_start (palette_current, palette_writes_per_line);
+    }
+
+    while (!(SMS_getKeysPressed () & PORT_A_KEY_2))
+    {
+        uint8_t v_count;
+
+        SMS_waitForVBlank ();
+
+        /* Full uploads, timed in lines */
+        v_count = SMS_getVCount ();
+        for (uint8_t i = 0; i < PALETTE_UPLOAD_REPEAT; i++)
+        {
+            SMS_loadBGPalette (&palette_next [0]);
+            SMS_loadSpritePalette (&palette_next [16]);
+        }
+        palette_current = palette_next;
+        palette_band_palette_set (palette_current);
+        upload_cycles = (uint16_t) (SMS_getVCount () - v_count) * CYCLES_PER_LINE / PALETTE_UPLOAD_REPEAT;
+
+        sprintf (string_buf, "%d  ", upload_cycles);
+        draw_string (17, 17, string_buf);
+        sprintf (string_buf, "%d  ", palette_band_overruns_get ());
+        draw_string (17, 19, string_buf);
+
+        /* Prepare the next fade level, to be uploaded in the next vblank */
+        if (fade && ++fade_timer == PALETTE_FADE_RATE)
+        {
+            fade_timer = 0;
+            fade_level += fade_step;
+            if (fade_level == 0 || fade_level == 3)
+            {
+                fade_step = -fade_step;
+            }
+
+            palette_next = (palette_current == palette_buffers [0]) ? palette_buffers [1] : palette_buffers [0];
+            for (uint8_t i = 0; i < 32; i++)
+            {
+                palette_next [i] = palette_fade_table [fade_level] [palette_base [i]];
+            }
+        }
+    }
+
+    palette_band_stop ();
+    SMS_waitForVBlank ();
+    palette_init ();
+}
+static void vdp_palette_fade (void)
+{
+    vdp_palette_stream (true);
+}
+static void vdp_palette_static (void)
+{
+    vdp_palette_stream (false);
+}
+
+
+static void vdp_palette_writes_per_line_set (uint16_t value)
+{
+    palette_writes_per_line = value;
+}
+
+
+/*
+ * Test for CRAM write bandwidth, with full palette uploads during
+ * vblank, and a configurable number of writes per line mid-frame.
+ */
+static void vdp_palette_menu (void)
+{
+    menu_new ("VDP PALETTE");
+    menu_item_add ("PALETTE FADE", vdp_palette_fade);
+    menu_item_add ("STATIC PALETTE", vdp_palette_static);
+    menu_item_add_value ("WRITES PER LINE", palette_writes_per_line, 0x20, vdp_palette_writes_per_line_set);
+}
+static void vdp_palette_test (void)
+{
+    menu_run (vdp_palette_menu);
+}
+
+
 /*
  * VDP test submenu
  */
@@ -247,7 +933,11 @@ static void vdp_menu (void)
     menu_item_add ("VDP BACKGROUND", vdp_background_test);
     menu_item_add ("VDP LINE INTERRUPTS", vdp_line_interrupt_test);
     menu_item_add ("VDP SCROLLING", vdp_scroll_test);
+    menu_item_add ("VDP MAP STREAMING", vdp_stream_test);
     menu_item_add ("VDP SPRITES", vdp_sprite_test);
+    menu_item_add ("VDP TEST PATTERNS", vdp_test_pattern_test);
+    menu_item_add ("VDP PALETTE", vdp_palette_test);
+    menu_item_add ("VDP TIMING", vdp_timing_menu_run);
 }
 void vdp_menu_run (void)
 {
@@ -0,0 +1,519 @@
+/*
+ * Sneptest SMS - VDP Timing Tests
+ *
+ * Built into the same ROM bank as the other VDP tests.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "SMSlib.h"
+#include "sneptest.h"
+#include "screens.h"
+
+__sfr __at (0x3f) IOControlPort;
+__sfr __at (0x7e) VCounterPort;
+__sfr __at (0x7f) HCounterPort;
+__sfr __at (0xbe) VDPDataPort;
+
+/* Scratch area of VRAM, between the tiles used by the tests and the name table */
+#define VRAM_SPEED_ADDRESS  0x3000
+#define VRAM_SPEED_WRITES   64
+#define VRAM_SPEED_PASSES   4
+
+#define VRAM_SPEED_MODE_VBLANK  0
+#define VRAM_SPEED_MODE_ACTIVE  1
+#define VRAM_SPEED_MODE_OFF     2
+#define VRAM_SPEED_MODES        3
+
+/* Line to begin the active-display writes on */
+#define VRAM_SPEED_ACTIVE_LINE 64
+
+static uint8_t vram_speed_seed = 0;
+
+/*
+ * Each writer makes VRAM_SPEED_WRITES writes of an incrementing value,
+ * starting at vram_speed_seed, with a fixed number of cycles from one
+ * write to the next. Timing is from either 'out (c), a' (12 cycles) or
+ * 'out (n), a' (11 cycles), plus a step of 'inc a' (4 cycles) with
+ * padding, or 'add a, #1' (7 cycles). No combination gives 17 cycles,
+ * so that interval is skipped.
+ */
+#define VRAM_SPEED_WRITER(cycles, write, step)          \
+static void vram_speed_write_##cycles (void) __naked    \
+{                                                       \
+    __asm__ ("ld a, (_vram_speed_seed)\n"               \
+             "ld c, #0xbe\n"                            \
+             "di\n"                                     \
+             ".rept 64\n"   /* VRAM_SPEED_WRITES */      \
+             write "\n"                                 \
+             step "\n"                                  \
+             ".endm\n"                                  \
+             "ei\n"                                     \
+             "ret\n");                                  \
+}
+
+VRAM_SPEED_WRITER (29, "out (c), a",     "inc a\n inc de\n cp (hl)")
+VRAM_SPEED_WRITER (28, "out (c), a",     "inc a\n nop\n nop\n nop")
+VRAM_SPEED_WRITER (27, "out (c), a",     "inc a\n nop\n cp (hl)")
+VRAM_SPEED_WRITER (26, "out (c), a",     "inc a\n nop\n inc de")
+VRAM_SPEED_WRITER (25, "out (#0xbe), a", "inc a\n nop\n inc de")
+VRAM_SPEED_WRITER (24, "out (c), a",     "inc a\n nop\n nop")
+VRAM_SPEED_WRITER (23, "out (c), a",     "inc a\n cp (hl)")
+VRAM_SPEED_WRITER (22, "out (c), a",     "inc a\n inc de")
+VRAM_SPEED_WRITER (21, "out (#0xbe), a", "inc a\n inc de")
+VRAM_SPEED_WRITER (20, "out (c), a",     "inc a\n nop")
+VRAM_SPEED_WRITER (19, "out (#0xbe), a", "inc a\n nop")
+VRAM_SPEED_WRITER (18, "out (#0xbe), a", "add a, #1")
+VRAM_SPEED_WRITER (16, "out (c), a",     "inc a")
+
+#define VRAM_SPEED_INTERVALS 13
+
+static void (* const vram_speed_writers [VRAM_SPEED_INTERVALS]) (void) = {
+    vram_speed_write_29, vram_speed_write_28, vram_speed_write_27, vram_speed_write_26,
+    vram_speed_write_25, vram_speed_write_24, vram_speed_write_23, vram_speed_write_22,
+    vram_speed_write_21, vram_speed_write_20, vram_speed_write_19, vram_speed_write_18,
+    vram_speed_write_16,
+};
+
+static const uint8_t vram_speed_cycles [VRAM_SPEED_INTERVALS] = {
+    29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 16
+};
+
+static uint16_t vram_speed_errors [VRAM_SPEED_MODES] [VRAM_SPEED_INTERVALS];
+
+
+/*
+ * Read back the scratch area, returning the number of bytes that
+ * do not match what was written.
+ */
+static uint8_t vram_speed_verify (void)
+{
+    uint8_t expected = vram_speed_seed;
+    uint8_t errors = 0;
+
+    SMS_setAddr (VRAM_SPEED_ADDRESS);
+    for (uint8_t i = 0; i < VRAM_SPEED_WRITES; i++)
+    {
+        if (VDPDataPort != expected++)
+        {
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+
+/*
+ * Run each writer in one mode. The read-back is always done
+ * in the following vblank, so that it cannot drop reads.
+ */
+static void vram_speed_run (uint8_t mode)
+{
+    if (mode == VRAM_SPEED_MODE_OFF)
+    {
+        SMS_waitForVBlank ();
+        SMS_displayOff ();
+    }
+
+    for (uint8_t i = 0; i < VRAM_SPEED_INTERVALS; i++)
+    {
+        vram_speed_errors [mode] [i] = 0;
+
+        for (uint8_t pass = 0; pass < VRAM_SPEED_PASSES; pass++)
+        {
+            /* A new seed for each pass, so stale data cannot pass the check */
+            vram_speed_seed += 0x35;
+
+            /* With the display off, write where the active display would be */
+            if (mode != VRAM_SPEED_MODE_VBLANK)
+            {
+                wait_for_active_display ();
+                while (SMS_getVCount () < VRAM_SPEED_ACTIVE_LINE);
+            }
+            else
+            {
+                SMS_waitForVBlank ();
+            }
+
+            SMS_setAddr (0x4000 | VRAM_SPEED_ADDRESS);
+            vram_speed_writers [i] ();
+
+            SMS_waitForVBlank ();
+            vram_speed_errors [mode] [i] += vram_speed_verify ();
+        }
+    }
+
+    if (mode == VRAM_SPEED_MODE_OFF)
+    {
+        SMS_displayOn ();
+    }
+}
+
+
+/*
+ * Test how closely spaced VRAM writes can be before they are dropped,
+ * during vblank, during active display, and with the display off.
+ */
+static void vdp_vram_speed_test (void)
+{
+    char string_buf [8] = { '\0' };
+    uint8_t line;
+
+    screen_load (screen_vdp_vram_speed);
+
+    while (true)
+    {
+        uint16_t pressed;
+
+        draw_string (10, 18, "RUNNING...         ");
+
+        for (uint8_t mode = 0; mode < VRAM_SPEED_MODES; mode++)
+        {
+            vram_speed_run (mode);
+        }
+
+        /* Error counts for each interval */
+        line = 5;
+        for (uint8_t i = 0; i < VRAM_SPEED_INTERVALS; i++)
+        {
+            sprintf (string_buf, "%d", vram_speed_cycles [i]);
+            draw_string (4, line, string_buf);
+
+            for (uint8_t mode = 0; mode < VRAM_SPEED_MODES; mode++)
+            {
+                sprintf (string_buf, "%-3d", vram_speed_errors [mode] [i]);
+                draw_string (12 + 8 * mode, line, string_buf);
+            }
+            line++;
+        }
+
+        /* Fastest interval before the first one with errors, for each mode.
+         * If a faster interval passes again after that, the result is not
+         * monotonic and is marked with an asterisk. */
+        draw_string (10, 18, "                   ");
+        for (uint8_t mode = 0; mode < VRAM_SPEED_MODES; mode++)
+        {
+            uint8_t fastest = 0;
+            bool failed = false;
+            bool monotonic = true;
+
+            for (uint8_t i = 0; i < VRAM_SPEED_INTERVALS; i++)
+            {
+                if (vram_speed_errors [mode] [i] != 0)
+                {
+                    failed = true;
+                }
+                else if (failed)
+                {
+                    monotonic = false;
+                }
+                else
+                {
+                    fastest = vram_speed_cycles [i];
+                }
+            }
+
+            if (fastest)
+            {
+                sprintf (string_buf, monotonic ? "%d " : "%d*", fastest);
+                draw_string (12 + 8 * mode, 19, string_buf);
+            }
+            else
+            {
+                draw_string (12 + 8 * mode, 19, monotonic ? "-- " : "--*");
+            }
+        }
+
+        do {
+            SMS_waitForVBlank ();
+            pressed = SMS_getKeysPressed ();
+        } while (!(pressed & (PORT_A_KEY_1 | PORT_A_KEY_2)));
+
+        if (pressed & PORT_A_KEY_2)
+        {
+            break;
+        }
+    }
+}
+
+
+/* Room for a full PAL frame, plus some margin for anomalies */
+#define V_COUNTER_BUFFER_SIZE   320
+#define H_COUNTER_SAMPLES       256
+
+/* The H-counter counts 171 positions per line, jumping from 0x93 to 0xe9 */
+#define H_COUNTER_POSITIONS     171
+#define H_COUNTER_JUMP_FROM     0x93
+#define H_COUNTER_JUMP_TO       0xe9
+
+/* Bits for port 0x3f: Port A TH as an output, with its level low or high */
+#define IO_TH_A_LOW     0xdd
+#define IO_TH_A_HIGH    0xfd
+#define IO_ALL_INPUT    0xff
+
+static uint8_t v_counter_sequence [V_COUNTER_BUFFER_SIZE];
+static uint16_t v_counter_length = 0;
+static uint16_t v_counter_samples = 0;
+static uint8_t h_counter_samples [H_COUNTER_SAMPLES];
+
+
+/*
+ * Sample the V-counter as quickly as possible for a whole frame,
+ * storing each new value seen. Interrupts are disabled so that
+ * the frame interrupt cannot cause values to be missed.
+ */
+static void v_counter_probe (void)
+{
+    uint8_t previous = 0;
+    uint8_t v_count;
+
+    v_counter_sequence [0] = 0;
+    v_counter_length = 1;
+    v_counter_samples = 1;
+
+    wait_for_active_display ();
+    __asm di __endasm;
+
+    while (v_counter_length < V_COUNTER_BUFFER_SIZE)
+    {
+        v_count = VCounterPort;
+        v_counter_samples++;
+
+        if (v_count != previous)
+        {
+            /* Back to the top of the next frame */
+            if (v_count == 0)
+            {
+                break;
+            }
+            v_counter_sequence [v_counter_length++] = v_count;
+            previous = v_count;
+        }
+    }
+
+    __asm ei __endasm;
+}
+
+
+/*
+ * Sample the H-counter as quickly as possible. The H-counter is only
+ * latched when TH changes, so each sample toggles port A's TH pin.
+ */
+static void h_counter_probe (void)
+{
+    wait_for_active_display ();
+    __asm di __endasm;
+
+    for (uint16_t i = 0; i < H_COUNTER_SAMPLES; i++)
+    {
+        IOControlPort = IO_TH_A_LOW;
+        IOControlPort = IO_TH_A_HIGH;
+        h_counter_samples [i] = HCounterPort;
+    }
+
+    IOControlPort = IO_ALL_INPUT;
+    __asm ei __endasm;
+}
+
+
+/*
+ * The expected V-counter value for a line of a 192-line frame.
+ *   NTSC: 0x00 - 0xda, then 0xd5 - 0xff
+ *   PAL:  0x00 - 0xf2, then 0xba - 0xff
+ */
+static uint8_t v_counter_expected (uint16_t line, bool pal)
+{
+    uint8_t jump_from = pal ? 0xf2 : 0xda;
+    uint8_t jump_to = pal ? 0xba : 0xd5;
+
+    if (line <= jump_from)
+    {
+        return line;
+    }
+    return jump_to + (line - jump_from - 1);
+}
+
+
+/*
+ * Convert an H-counter value into its position within the line.
+ */
+static uint8_t h_counter_position (uint8_t h_count)
+{
+    if (h_count <= H_COUNTER_JUMP_FROM)
+    {
+        return h_count;
+    }
+    return h_count - (H_COUNTER_JUMP_TO - H_COUNTER_JUMP_FROM - 1);
+}
+
+
+/*
+ * Draw a bar of up to 20 cells, followed by its value.
+ */
+static void counter_bar_draw (uint8_t y, uint16_t value)
+{
+    char string_buf [32];
+    uint8_t i;
+
+    for (i = 0; i < value && i < 20; i++)
+    {
+        string_buf [i] = '*';
+    }
+    sprintf (&string_buf [i], " %d    ", value);
+    string_buf [30] = '\0';
+    draw_string (2, y, string_buf);
+}
+
+
+/*
+ * Probe the V-counter and H-counter, check the values against
+ * the known jump points, and show the sample rates achieved.
+ */
+static void vdp_counter_test (void)
+{
+    char string_buf [32] = { '\0' };
+
+    screen_load (screen_vdp_counters);
+
+    while (true)
+    {
+        uint16_t pressed;
+        uint16_t anomalies = 0;
+        uint16_t first_anomaly = 0;
+        uint16_t expected_length;
+        uint8_t jump_from = 0;
+        uint8_t jump_to = 0;
+        uint8_t h_low_max = 0;
+        uint8_t h_high_min = 0xff;
+        uint32_t h_distance = 0;
+        bool pal;
+
+        v_counter_probe ();
+        h_counter_probe ();
+
+        /* V-counter: Find the jump, and compare against the expected sequence */
+        pal = (v_counter_length > 287);
+        expected_length = pal ? 313 : 262;
+
+        for (uint16_t i = 1; i < v_counter_length; i++)
+        {
+            if (v_counter_sequence [i] < v_counter_sequence [i - 1])
+            {
+                jump_from = v_counter_sequence [i - 1];
+                jump_to = v_counter_sequence [i];
+                break;
+            }
+        }
+
+        for (uint16_t i = 0; i < v_counter_length || i < expected_length; i++)
+        {
+            if (i >= v_counter_length || i >= expected_length ||
+                v_counter_sequence [i] != v_counter_expected (i, pal))
+            {
+                if (anomalies++ == 0)
+                {
+                    first_anomaly = i;
+                }
+            }
+        }
+
+        sprintf (string_buf, "LINES: %d %s  ", v_counter_length, pal ? "PAL " : "NTSC");
+        draw_string (4, 5, string_buf);
+        sprintf (string_buf, "JUMP: %02X -> %02X", jump_from, jump_to);
+        draw_string (4, 6, string_buf);
+        if (anomalies)
+        {
+            sprintf (string_buf, "ANOMALIES: %d AT LINE %d     ", anomalies, first_anomaly);
+        }
+        else
+        {
+            sprintf (string_buf, "ANOMALIES: NONE              ");
+        }
+        draw_string (4, 7, string_buf);
+        counter_bar_draw (9, v_counter_samples / v_counter_length);
+
+        /* H-counter: Values must fall either side of the jump */
+        anomalies = 0;
+        for (uint16_t i = 0; i < H_COUNTER_SAMPLES; i++)
+        {
+            uint8_t h_count = h_counter_samples [i];
+
+            if (h_count <= H_COUNTER_JUMP_FROM)
+            {
+                if (h_count > h_low_max)
+                {
+                    h_low_max = h_count;
+                }
+            }
+            else if (h_count >= H_COUNTER_JUMP_TO)
+            {
+                if (h_count < h_high_min)
+                {
+                    h_high_min = h_count;
+                }
+            }
+            else
+            {
+                anomalies++;
+            }
+
+            if (i > 0)
+            {
+                h_distance += (h_counter_position (h_count) + H_COUNTER_POSITIONS -
+                               h_counter_position (h_counter_samples [i - 1])) % H_COUNTER_POSITIONS;
+            }
+        }
+
+        sprintf (string_buf, "LOW MAX: %02X  HIGH MIN: %02X", h_low_max, h_high_min);
+        draw_string (4, 13, string_buf);
+        if (anomalies)
+        {
+            sprintf (string_buf, "ANOMALIES: %d IN JUMP GAP   ", anomalies);
+        }
+        else
+        {
+            sprintf (string_buf, "ANOMALIES: NONE              ");
+        }
+        draw_string (4, 14, string_buf);
+        sprintf (string_buf, "CYCLES PER SAMPLE: %d  ",
+                 (uint16_t) (h_distance * CYCLES_PER_LINE / (H_COUNTER_POSITIONS * (H_COUNTER_SAMPLES - 1))));
+        draw_string (4, 15, string_buf);
+
+        /* If the H-counter never moved, latching is not implemented */
+        if (h_distance)
+        {
+            counter_bar_draw (17, (uint16_t) (H_COUNTER_POSITIONS * (H_COUNTER_SAMPLES - 1) / h_distance));
+        }
+        else
+        {
+            draw_string (2, 17, "NOT LATCHING                  ");
+        }
+
+        do {
+            SMS_waitForVBlank ();
+            pressed = SMS_getKeysPressed ();
+        } while (!(pressed & (PORT_A_KEY_1 | PORT_A_KEY_2)));
+
+        if (pressed & PORT_A_KEY_2)
+        {
+            break;
+        }
+    }
+}
+
+
+/*
+ * VDP timing test submenu
+ */
+static void vdp_timing_menu (void)
+{
+    menu_new ("VDP TIMING");
+    menu_item_add ("VRAM ACCESS SPEED", vdp_vram_speed_test);
+    menu_item_add ("V/H COUNTERS", vdp_counter_test);
+}
+void vdp_timing_menu_run (void)
+{
+    menu_run (vdp_timing_menu);
+}
@@ -0,0 +1,2 @@
+
+void vdp_timing_menu_run (void);
@@ -0,0 +1,118 @@
+/*
+ * Sneptest SMS - VRAM streaming
+ *
+ * Decompresses data from tools/tilepack.c straight into VRAM. The
+ * work can be split into budgeted chunks, to spread a large load
+ * across several vblanks while the display is on.
+ *
+ * This lives in the fixed slots, as the source data is paged into
+ * slot 2 for each chunk.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "SMSlib.h"
+#include "vram_stream.h"
+
+__sfr __at (0xbe) VDPDataPort;
+
+/* Window of recent output, for copies. As it is shared,
+ * only one stream may be in progress at a time. */
+static uint8_t window [256];
+static uint8_t window_index = 0;
+
+
+/*
+ * Prepare to stream compressed data from a ROM bank to
+ * a VDP write address.
+ */
+void vram_stream_init (vram_stream *stream, uint8_t bank, const uint8_t *source, uint16_t dest)
+{
+    stream->bank = bank;
+    stream->source = source;
+    stream->dest = dest;
+    stream->count = 0;
+    stream->copy = false;
+    stream->done = false;
+    window_index = 0;
+}
+
+
+/*
+ * Decompress up to 'budget' bytes of the stream into VRAM.
+ * Returns the number of bytes written.
+ *
+ * Note: No attempt is made to respect the VDP's access timing, so
+ *       this should be called in vblank or with the display off.
+ */
+uint16_t vram_stream_step (vram_stream *stream, uint16_t budget)
+{
+    const uint8_t *source = stream->source;
+    uint8_t count = stream->count;
+    uint8_t copy_index = stream->copy_index;
+    uint16_t written = 0;
+    SMS_saveROMBank ();
+
+    SMS_mapROMBank (stream->bank);
+    SMS_setAddr (stream->dest);
+
+    while (written < budget)
+    {
+        uint8_t chunk;
+
+        /* Start of the next token */
+        if (count == 0)
+        {
+            uint8_t token = *source++;
+
+            if (token == 0x00)
+            {
+                stream->done = true;
+                break;
+            }
+            else if (token & 0x80)
+            {
+                stream->copy = true;
+                count = (token & 0x7f) + 3;
+                copy_index = window_index - *source++ - 1;
+            }
+            else
+            {
+                stream->copy = false;
+                count = token;
+            }
+        }
+
+        chunk = (budget - written < count) ? budget - written : count;
+        count -= chunk;
+        written += chunk;
+
+        if (stream->copy)
+        {
+            while (chunk--)
+            {
+                uint8_t byte = window [copy_index++];
+                VDPDataPort = byte;
+                window [window_index++] = byte;
+            }
+        }
+        else
+        {
+            while (chunk--)
+            {
+                uint8_t byte = *source++;
+                VDPDataPort = byte;
+                window [window_index++] = byte;
+            }
+        }
+    }
+
+    SMS_restoreROMBank ();
+
+    stream->source = source;
+    stream->count = count;
+    stream->copy_index = copy_index;
+    stream->dest += written;
+
+    return written;
+}
@@ -0,0 +1,13 @@
+
+typedef struct vram_stream_s {
+    uint8_t bank;
+    const uint8_t *source;
+    uint16_t dest;
+    uint8_t count;
+    uint8_t copy_index;
+    bool copy;
+    bool done;
+} vram_stream;
+
+void vram_stream_init (vram_stream *stream, uint8_t bank, const uint8_t *source, uint16_t dest);
+uint16_t vram_stream_step (vram_stream *stream, uint16_t budget);
@@ -0,0 +1,153 @@
+/*
+ * Sneptest SMS - Map generator
+ *
+ * Build-time tool to generate a large tile map for the map streaming
+ * test. The map uses the font tiles, and is split into one C source
+ * file per ROM bank, MAP_BANK_ROWS rows each.
+ *
+ * Usage: mapgen <output prefix>
+ *
+ * The map is a grid of 16x16 tile blocks, each labelled with its
+ * block coordinates, over a scattering of dots so that movement is
+ * visible everywhere.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAP_WIDTH       256
+#define MAP_HEIGHT      256
+#define MAP_BANK_ROWS   64
+#define MAP_BANKS       (MAP_HEIGHT / MAP_BANK_ROWS)
+#define MAP_BLOCK       16
+
+/* Font tiles, matching main.c */
+#define TILE(c)         ((c) - ' ')
+#define BOX_LINE_H      59
+#define BOX_LINE_V      60
+
+static uint8_t map [MAP_HEIGHT] [MAP_WIDTH];
+
+
+/*
+ * Write a string into the map.
+ */
+static void map_string (uint32_t x, uint32_t y, const char *string)
+{
+    while (*string)
+    {
+        map [y] [x++] = TILE (*string++);
+    }
+}
+
+
+static void map_generate (void)
+{
+    static const char hex [] = "0123456789ABCDEF";
+    uint32_t seed = 0x12345678;
+
+    for (uint32_t y = 0; y < MAP_HEIGHT; y++)
+    {
+        for (uint32_t x = 0; x < MAP_WIDTH; x++)
+        {
+            /* Simple LCG, for a repeatable scattering of dots */
+            seed = seed * 1103515245 + 12345;
+
+            if (x % MAP_BLOCK == 0 && y % MAP_BLOCK == 0)
+            {
+                map [y] [x] = TILE ('+');
+            }
+            else if (y % MAP_BLOCK == 0)
+            {
+                map [y] [x] = BOX_LINE_H;
+            }
+            else if (x % MAP_BLOCK == 0)
+            {
+                map [y] [x] = BOX_LINE_V;
+            }
+            else if (((seed >> 16) & 0x0f) == 0)
+            {
+                map [y] [x] = TILE ('.');
+            }
+            else
+            {
+                map [y] [x] = TILE (' ');
+            }
+        }
+    }
+
+    /* Label each block with its coordinates */
+    for (uint32_t y = 0; y < MAP_HEIGHT; y += MAP_BLOCK)
+    {
+        for (uint32_t x = 0; x < MAP_WIDTH; x += MAP_BLOCK)
+        {
+            char label [] = "X0 Y0";
+            label [1] = hex [x / MAP_BLOCK];
+            label [4] = hex [y / MAP_BLOCK];
+            map_string (x + 2, y + 2, label);
+        }
+    }
+}
+
+
+int main (int argc, char **argv)
+{
+    char path [1024];
+    FILE *file;
+
+    if (argc != 2)
+    {
+        fprintf (stderr, "Usage: %s <output prefix>\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    map_generate ();
+
+    /* One source file per bank */
+    for (uint32_t bank = 0; bank < MAP_BANKS; bank++)
+    {
+        snprintf (path, sizeof (path), "%s_%u.c", argv [1], bank);
+        file = fopen (path, "w");
+        if (file == NULL)
+        {
+            fprintf (stderr, "Error: Unable to create %s\n", path);
+            return EXIT_FAILURE;
+        }
+
+        fprintf (file, "/* Generated by mapgen, rows %u to %u */\n\n#include <stdint.h>\n\n",
+                 bank * MAP_BANK_ROWS, (bank + 1) * MAP_BANK_ROWS - 1);
+        fprintf (file, "const uint8_t map_%u [] = {", bank);
+        for (uint32_t y = bank * MAP_BANK_ROWS; y < (bank + 1) * MAP_BANK_ROWS; y++)
+        {
+            for (uint32_t x = 0; x < MAP_WIDTH; x++)
+            {
+                fprintf (file, "%s0x%02x,", (x % 16) ? " " : "\n    ", map [y] [x]);
+            }
+        }
+        fprintf (file, "\n};\n");
+        fclose (file);
+    }
+
+    /* Header */
+    snprintf (path, sizeof (path), "%s.h", argv [1]);
+    file = fopen (path, "w");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Error: Unable to create %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    fprintf (file, "/* Generated by mapgen */\n\n");
+    for (uint32_t bank = 0; bank < MAP_BANKS; bank++)
+    {
+        fprintf (file, "extern const uint8_t map_%u [];\n", bank);
+    }
+    fprintf (file, "\n#define MAP_WIDTH %u\n", MAP_WIDTH);
+    fprintf (file, "#define MAP_HEIGHT %u\n", MAP_HEIGHT);
+    fprintf (file, "#define MAP_BANK_ROWS %u\n", MAP_BANK_ROWS);
+    fprintf (file, "#define MAP_BANKS %u\n", MAP_BANKS);
+    fclose (file);
+
+    return EXIT_SUCCESS;
+}
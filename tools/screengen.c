@@ -0,0 +1,204 @@
+/*
+ * Sneptest SMS - Screen generator
+ *
+ * Build-time tool to convert text layouts of the static parts of test
+ * screens into tilemaps, so that each screen can be loaded in a single
+ * upload by screen_load.
+ *
+ * Usage: screengen <output prefix> <screen.txt> [<screen.txt> ...]
+ *
+ * Each screen is plain text, up to 32 characters wide and 24 lines
+ * tall, and is padded with spaces. Characters from ' ' to 'Z' use the
+ * font tiles, and the UTF-8 box-drawing characters below use the box
+ * tiles. Each screen is named after its file, without the extension.
+ *
+ * Output is one byte per name table entry, as the font and box tiles
+ * all fit in the low byte, with no flags.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCREEN_WIDTH    32
+#define SCREEN_HEIGHT   24
+
+/* Font tiles, matching main.c */
+#define BOX_LINE_H      59
+#define BOX_LINE_V      60
+#define BOX_CORNER_TR   61
+#define BOX_CORNER_BR   62
+
+static const struct {
+    const char *utf8;
+    uint8_t tile;
+} box_chars [] = {
+    { "─", BOX_LINE_H },
+    { "│", BOX_LINE_V },
+    { "┐", BOX_CORNER_TR },
+    { "┘", BOX_CORNER_BR },
+};
+
+static uint8_t screen [SCREEN_HEIGHT] [SCREEN_WIDTH];
+
+
+/*
+ * Read a screen layout into memory.
+ */
+static int screen_read (const char *path)
+{
+    char line [1024];
+    uint32_t y = 0;
+    FILE *file = fopen (path, "r");
+
+    if (file == NULL)
+    {
+        fprintf (stderr, "Error: Unable to open %s\n", path);
+        return -1;
+    }
+
+    memset (screen, 0, sizeof (screen));
+
+    while (fgets (line, sizeof (line), file))
+    {
+        const char *c = line;
+        uint32_t x = 0;
+
+        line [strcspn (line, "\r\n")] = '\0';
+
+        if (y >= SCREEN_HEIGHT)
+        {
+            fprintf (stderr, "Error: %s: Screen is taller than %u lines\n", path, SCREEN_HEIGHT);
+            fclose (file);
+            return -1;
+        }
+
+        while (*c != '\0')
+        {
+            uint8_t tile = 0;
+            bool found = false;
+
+            if (*c >= ' ' && *c <= 'Z')
+            {
+                tile = *c - ' ';
+                found = true;
+                c++;
+            }
+            else
+            {
+                for (uint32_t i = 0; i < sizeof (box_chars) / sizeof (box_chars [0]); i++)
+                {
+                    uint32_t length = strlen (box_chars [i].utf8);
+                    if (strncmp (c, box_chars [i].utf8, length) == 0)
+                    {
+                        tile = box_chars [i].tile;
+                        found = true;
+                        c += length;
+                        break;
+                    }
+                }
+            }
+
+            if (!found)
+            {
+                fprintf (stderr, "Error: %s: Invalid character on line %u\n", path, y + 1);
+                fclose (file);
+                return -1;
+            }
+
+            if (x >= SCREEN_WIDTH)
+            {
+                fprintf (stderr, "Error: %s: Line %u is wider than %u characters\n", path, y + 1, SCREEN_WIDTH);
+                fclose (file);
+                return -1;
+            }
+
+            screen [y] [x++] = tile;
+        }
+        y++;
+    }
+
+    fclose (file);
+    return 0;
+}
+
+
+/*
+ * Name a screen after its file, without the directory or extension.
+ */
+static void screen_name (const char *path, char *name, size_t size)
+{
+    const char *base = strrchr (path, '/');
+
+    base = (base == NULL) ? path : base + 1;
+    snprintf (name, size, "%.*s", (int) strcspn (base, "."), base);
+}
+
+
+int main (int argc, char **argv)
+{
+    char path [1024];
+    char name [256];
+    FILE *source;
+    FILE *header;
+
+    if (argc < 3)
+    {
+        fprintf (stderr, "Usage: %s <output prefix> <screen.txt> [<screen.txt> ...]\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    snprintf (path, sizeof (path), "%s.c", argv [1]);
+    source = fopen (path, "w");
+    if (source == NULL)
+    {
+        fprintf (stderr, "Error: Unable to create %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    snprintf (path, sizeof (path), "%s.h", argv [1]);
+    header = fopen (path, "w");
+    if (header == NULL)
+    {
+        fprintf (stderr, "Error: Unable to create %s\n", path);
+        fclose (source);
+        return EXIT_FAILURE;
+    }
+
+    fprintf (source, "/* Generated by screengen */\n\n#include <stdint.h>\n");
+    fprintf (header, "/* Generated by screengen */\n\n");
+    fprintf (header, "#define SCREEN_WIDTH %u\n", SCREEN_WIDTH);
+    fprintf (header, "#define SCREEN_HEIGHT %u\n", SCREEN_HEIGHT);
+    fprintf (header, "#define SCREEN_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT)\n\n");
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (screen_read (argv [i]) < 0)
+        {
+            fclose (source);
+            fclose (header);
+            return EXIT_FAILURE;
+        }
+
+        screen_name (argv [i], name, sizeof (name));
+
+        fprintf (source, "\nconst uint8_t screen_%s [] = {", name);
+        for (uint32_t y = 0; y < SCREEN_HEIGHT; y++)
+        {
+            for (uint32_t x = 0; x < SCREEN_WIDTH; x++)
+            {
+                fprintf (source, "%s0x%02x,", (x % 16) ? " " : "\n    ", screen [y] [x]);
+            }
+        }
+        fprintf (source, "\n};\n");
+
+        fprintf (header, "extern const uint8_t screen_%s [];\n", name);
+    }
+
+    fclose (source);
+    fclose (header);
+
+    return EXIT_SUCCESS;
+}
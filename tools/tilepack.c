@@ -0,0 +1,442 @@
+/*
+ * Sneptest SMS - Tile packer
+ *
+ * Build-time tool to convert a full-screen image into a compressed
+ * tile set and tilemap, for streaming into VRAM by vram_stream.c
+ *
+ * Usage: tilepack <image.txt> <name> <base tile> <output prefix>
+ *
+ * The image is plain text, one hex digit per pixel giving the
+ * palette index. Lines starting with '#' are comments, and a line
+ * starting with "palette" lists up to 16 colours in SMS format.
+ * The image must be 256 pixels wide, so that the tilemap can be
+ * written to the name table as one continuous run.
+ *
+ * Compressed format, an LZSS variant limited to a 256-byte window so
+ * that the decompressor only needs a small ring buffer in RAM:
+ *   0x00         End of stream
+ *   0x01 - 0x7f  Literal, n bytes follow
+ *   0x80 - 0xff  Copy (n & 0x7f) + 3 bytes, starting the number of bytes
+ *                back given by the following byte, plus one. The copy
+ *                may overlap its own output, so runs are a copy from
+ *                one or two bytes back.
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMAGE_WIDTH     256
+#define IMAGE_HEIGHT_MAX 224
+#define TILES_MAX       448
+
+#define TILE_FLIP_H     0x0200
+#define TILE_FLIP_V     0x0400
+
+#define LITERAL_MAX     0x7f
+#define COPY_MIN        3
+#define COPY_MAX        (0x7f + COPY_MIN)
+#define WINDOW_SIZE     256
+
+static uint8_t image [IMAGE_HEIGHT_MAX] [IMAGE_WIDTH];
+static uint32_t image_height = 0;
+static uint8_t palette [16] = { 0 };
+
+/* Tiles stored as 8x8 palette indices, for easy flip comparisons */
+static uint8_t tiles [TILES_MAX] [8] [8];
+static uint32_t tile_count = 0;
+
+static uint16_t tilemap [IMAGE_HEIGHT_MAX / 8] [IMAGE_WIDTH / 8];
+
+
+/*
+ * Read the text image into memory.
+ */
+static int image_read (const char *path)
+{
+    char line [1024];
+    FILE *file = fopen (path, "r");
+
+    if (file == NULL)
+    {
+        fprintf (stderr, "Error: Unable to open %s\n", path);
+        return -1;
+    }
+
+    while (fgets (line, sizeof (line), file))
+    {
+        uint32_t length = strlen (line);
+
+        while (length && isspace ((unsigned char) line [length - 1]))
+        {
+            line [--length] = '\0';
+        }
+
+        if (length == 0 || line [0] == '#')
+        {
+            continue;
+        }
+
+        if (strncmp (line, "palette", 7) == 0)
+        {
+            char *next = line + 7;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                char *end;
+                unsigned long colour = strtoul (next, &end, 16);
+                if (end == next)
+                {
+                    break;
+                }
+                palette [i] = colour & 0x3f;
+                next = end;
+            }
+            continue;
+        }
+
+        if (length != IMAGE_WIDTH)
+        {
+            fprintf (stderr, "Error: %s: Image line %u is %u pixels wide, expected %u\n",
+                     path, image_height, length, IMAGE_WIDTH);
+            fclose (file);
+            return -1;
+        }
+
+        if (image_height >= IMAGE_HEIGHT_MAX)
+        {
+            fprintf (stderr, "Error: %s: Image is taller than %u pixels\n", path, IMAGE_HEIGHT_MAX);
+            fclose (file);
+            return -1;
+        }
+
+        for (uint32_t x = 0; x < IMAGE_WIDTH; x++)
+        {
+            if (!isxdigit ((unsigned char) line [x]))
+            {
+                fprintf (stderr, "Error: %s: Invalid pixel '%c' on image line %u\n", path, line [x], image_height);
+                fclose (file);
+                return -1;
+            }
+            image [image_height] [x] = strtoul ((char []) { line [x], '\0' }, NULL, 16);
+        }
+        image_height++;
+    }
+
+    fclose (file);
+
+    if (image_height == 0 || image_height % 8)
+    {
+        fprintf (stderr, "Error: %s: Image height must be a non-zero multiple of 8\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Compare a candidate tile against a stored tile, with optional flipping.
+ */
+static bool tile_match (uint8_t candidate [8] [8], uint8_t stored [8] [8], bool flip_h, bool flip_v)
+{
+    for (uint32_t y = 0; y < 8; y++)
+    {
+        for (uint32_t x = 0; x < 8; x++)
+        {
+            if (candidate [y] [x] != stored [flip_v ? 7 - y : y] [flip_h ? 7 - x : x])
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Split the image into tiles, de-duplicating any that are
+ * identical or flipped copies of a previous tile.
+ */
+static int image_to_tiles (uint32_t base_tile)
+{
+    for (uint32_t row = 0; row < image_height / 8; row++)
+    {
+        for (uint32_t col = 0; col < IMAGE_WIDTH / 8; col++)
+        {
+            uint8_t candidate [8] [8];
+            bool found = false;
+
+            for (uint32_t y = 0; y < 8; y++)
+            {
+                memcpy (candidate [y], &image [row * 8 + y] [col * 8], 8);
+            }
+
+            for (uint32_t i = 0; i < tile_count && !found; i++)
+            {
+                for (uint32_t flip = 0; flip < 4; flip++)
+                {
+                    if (tile_match (candidate, tiles [i], flip & 1, flip & 2))
+                    {
+                        tilemap [row] [col] = (base_tile + i) | ((flip & 1) ? TILE_FLIP_H : 0)
+                                                              | ((flip & 2) ? TILE_FLIP_V : 0);
+                        found = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!found)
+            {
+                if (base_tile + tile_count >= TILES_MAX)
+                {
+                    fprintf (stderr, "Error: Image needs more than %u tiles\n", TILES_MAX - base_tile);
+                    return -1;
+                }
+                memcpy (tiles [tile_count], candidate, sizeof (candidate));
+                tilemap [row] [col] = base_tile + tile_count;
+                tile_count++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Convert the tiles into the VDP's planar 4bpp format.
+ */
+static uint32_t tiles_to_planar (uint8_t *buffer)
+{
+    uint32_t size = 0;
+
+    for (uint32_t i = 0; i < tile_count; i++)
+    {
+        for (uint32_t y = 0; y < 8; y++)
+        {
+            for (uint32_t plane = 0; plane < 4; plane++)
+            {
+                uint8_t byte = 0;
+                for (uint32_t x = 0; x < 8; x++)
+                {
+                    byte = (byte << 1) | ((tiles [i] [y] [x] >> plane) & 1);
+                }
+                buffer [size++] = byte;
+            }
+        }
+    }
+
+    return size;
+}
+
+
+/*
+ * Convert the tilemap into name table entries, low byte first.
+ */
+static uint32_t tilemap_to_bytes (uint8_t *buffer)
+{
+    uint32_t size = 0;
+
+    for (uint32_t row = 0; row < image_height / 8; row++)
+    {
+        for (uint32_t col = 0; col < IMAGE_WIDTH / 8; col++)
+        {
+            buffer [size++] = tilemap [row] [col] & 0xff;
+            buffer [size++] = tilemap [row] [col] >> 8;
+        }
+    }
+
+    return size;
+}
+
+
+/*
+ * Find the longest match for the data at 'position' within the window.
+ */
+static uint32_t match_find (const uint8_t *input, uint32_t input_size, uint32_t position, uint32_t *offset)
+{
+    uint32_t best_length = 0;
+
+    for (uint32_t distance = 1; distance <= WINDOW_SIZE && distance <= position; distance++)
+    {
+        uint32_t length = 0;
+
+        while (length < COPY_MAX && position + length < input_size &&
+               input [position + length] == input [position - distance + length])
+        {
+            length++;
+        }
+
+        if (length > best_length)
+        {
+            best_length = length;
+            *offset = distance;
+        }
+    }
+
+    return best_length;
+}
+
+
+/*
+ * Flush any pending literal bytes to the output.
+ */
+static uint32_t literal_flush (const uint8_t *input, uint32_t start, uint32_t count, uint8_t *output)
+{
+    if (count)
+    {
+        output [0] = count;
+        memcpy (&output [1], &input [start], count);
+        return count + 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Compress a buffer, returning the compressed size.
+ */
+static uint32_t compress (const uint8_t *input, uint32_t input_size, uint8_t *output)
+{
+    uint32_t in = 0;
+    uint32_t out = 0;
+    uint32_t literal_start = 0;
+    uint32_t literal_count = 0;
+
+    while (in < input_size)
+    {
+        uint32_t offset = 0;
+        uint32_t length = match_find (input, input_size, in, &offset);
+
+        if (length >= COPY_MIN)
+        {
+            out += literal_flush (input, literal_start, literal_count, &output [out]);
+            literal_count = 0;
+
+            output [out++] = 0x80 | (length - COPY_MIN);
+            output [out++] = offset - 1;
+            in += length;
+            continue;
+        }
+
+        if (literal_count == 0)
+        {
+            literal_start = in;
+        }
+        literal_count++;
+        in++;
+
+        if (literal_count == LITERAL_MAX)
+        {
+            out += literal_flush (input, literal_start, literal_count, &output [out]);
+            literal_count = 0;
+        }
+    }
+
+    out += literal_flush (input, literal_start, literal_count, &output [out]);
+    output [out++] = 0x00;
+
+    return out;
+}
+
+
+/*
+ * Write a byte array as C source.
+ */
+static void array_write (FILE *file, const char *name, const char *suffix, const uint8_t *data, uint32_t size)
+{
+    fprintf (file, "const uint8_t %s_%s [] = {", name, suffix);
+    for (uint32_t i = 0; i < size; i++)
+    {
+        fprintf (file, "%s0x%02x,", (i % 16) ? " " : "\n    ", data [i]);
+    }
+    fprintf (file, "\n};\n\n");
+}
+
+
+int main (int argc, char **argv)
+{
+    static uint8_t raw [TILES_MAX * 32];
+    static uint8_t packed [TILES_MAX * 32 * 2];
+    uint32_t base_tile;
+    uint32_t raw_size;
+    uint32_t packed_size;
+    char path [1024];
+    char upper [256];
+    const char *name;
+    FILE *file;
+
+    if (argc != 5)
+    {
+        fprintf (stderr, "Usage: %s <image.txt> <name> <base tile> <output prefix>\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    name = argv [2];
+    base_tile = strtoul (argv [3], NULL, 0);
+
+    for (uint32_t i = 0; i < sizeof (upper) - 1 && name [i]; i++)
+    {
+        upper [i] = toupper ((unsigned char) name [i]);
+        upper [i + 1] = '\0';
+    }
+
+    if (image_read (argv [1]) || image_to_tiles (base_tile))
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* Source */
+    snprintf (path, sizeof (path), "%s.c", argv [4]);
+    file = fopen (path, "w");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Error: Unable to create %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    fprintf (file, "/* Generated by tilepack from %s */\n\n#include <stdint.h>\n\n", argv [1]);
+
+    raw_size = tiles_to_planar (raw);
+    packed_size = compress (raw, raw_size, packed);
+    array_write (file, name, "tiles", packed, packed_size);
+    printf ("  %s: %u tiles, %u -> %u bytes\n", name, tile_count, raw_size, packed_size);
+
+    raw_size = tilemap_to_bytes (raw);
+    packed_size = compress (raw, raw_size, packed);
+    array_write (file, name, "tilemap", packed, packed_size);
+    printf ("  %s: tilemap, %u -> %u bytes\n", name, raw_size, packed_size);
+
+    fclose (file);
+
+    /* Header */
+    snprintf (path, sizeof (path), "%s.h", argv [4]);
+    file = fopen (path, "w");
+    if (file == NULL)
+    {
+        fprintf (stderr, "Error: Unable to create %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    fprintf (file, "/* Generated by tilepack from %s */\n\n", argv [1]);
+    fprintf (file, "extern const uint8_t %s_tiles [];\n", name);
+    fprintf (file, "extern const uint8_t %s_tilemap [];\n\n", name);
+    fprintf (file, "#define %s_BASE_TILE %u\n", upper, base_tile);
+    fprintf (file, "#define %s_TILE_COUNT %u\n", upper, tile_count);
+    fprintf (file, "#define %s_SIZE %u\n", upper, tile_count * 32 + raw_size);
+    fprintf (file, "#define %s_PALETTE {", upper);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        fprintf (file, "%s0x%02x", i ? ", " : " ", palette [i]);
+    }
+    fprintf (file, " }\n");
+
+    fclose (file);
+
+    return EXIT_SUCCESS;
+}